@@ -0,0 +1,65 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "enumerable.hpp"
+#include <chrono>
+#include <cstdio>
+
+using namespace linq;
+
+namespace
+{
+  const int elementCount = 200000;
+
+  // Burns roughly cost units of CPU without being optimized away.
+  int work(int value, int cost)
+  {
+    volatile int acc = value;
+    for (int i = 0; i < cost; ++i)
+      acc = acc * 31 + i;
+    return value + (acc & 1);
+  }
+
+  template <typename TQuery>
+  void measure(const char* name, TQuery query)
+  {
+    auto start = std::chrono::steady_clock::now();
+    auto result = query().to_vector();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-36s %10.0f elements/s (%zu results)\n", name, elementCount / elapsed, result.size());
+  }
+}
+
+int main()
+{
+  measure("2 stages, sequential", []
+  {
+    return range(0, elementCount)
+      .select([](int v) {return work(v, 200);})
+      .select([](int v) {return work(v, 400);});
+  });
+  measure("2 stages, pipelined", []
+  {
+    return range(0, elementCount)
+      .select([](int v) {return work(v, 200);})
+      .pipelined()
+      .select([](int v) {return work(v, 400);});
+  });
+  measure("3 stages, sequential", []
+  {
+    return range(0, elementCount)
+      .select([](int v) {return work(v, 100);})
+      .select([](int v) {return work(v, 400);})
+      .where([](int v) {return work(v, 200) % 2 == 0;});
+  });
+  measure("3 stages, pipelined", []
+  {
+    return range(0, elementCount)
+      .select([](int v) {return work(v, 100);})
+      .pipelined()
+      .select([](int v) {return work(v, 400);})
+      .pipelined()
+      .where([](int v) {return work(v, 200) % 2 == 0;});
+  });
+  return 0;
+}
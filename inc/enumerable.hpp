@@ -4,9 +4,20 @@
 #pragma once
 #include <iterator>
 #include <vector>
-#include <map>
+#include <string>
+#include <algorithm>
 #include <memory>
 #include <functional>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
 
 namespace linq
 {
@@ -23,6 +34,78 @@ namespace linq
     }
   };
 
+  // Reads and writes values to the temporary files used when a sort spills
+  // past its memory budget. Trivially copyable types are written as raw
+  // bytes; specialize this template for any other type that needs to spill.
+  // Types without a serializer can still be sorted, just not spilled.
+  template <typename T, typename = void>
+  struct serializer
+  {
+  };
+
+  template <typename T>
+  struct serializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type>
+  {
+    static bool write(std::FILE* file, const T& value)
+    {
+      return std::fwrite(&value, sizeof(T), 1, file) == 1;
+    }
+
+    static bool read(std::FILE* file, T& value)
+    {
+      return std::fread(&value, sizeof(T), 1, file) == 1;
+    }
+  };
+
+  template <>
+  struct serializer<std::string>
+  {
+    static bool write(std::FILE* file, const std::string& value)
+    {
+      auto size = value.size();
+      return serializer<size_t>::write(file, size)
+        && std::fwrite(value.data(), 1, size, file) == size;
+    }
+
+    static bool read(std::FILE* file, std::string& value)
+    {
+      size_t size;
+      if (!serializer<size_t>::read(file, size))
+        return false;
+      value.resize(size);
+      return size == 0 || std::fread(&value[0], 1, size, file) == size;
+    }
+  };
+
+  namespace detail
+  {
+    template <typename T, typename = void>
+    struct has_serializer : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct has_serializer<T, decltype(void(serializer<T>::write(std::declval<std::FILE*>(), std::declval<const T&>())))> : std::true_type
+    {
+    };
+  }
+
+  template <typename TFirst, typename TSecond>
+  struct serializer<std::pair<TFirst, TSecond>, typename std::enable_if<detail::has_serializer<TFirst>::value && detail::has_serializer<TSecond>::value>::type>
+  {
+    static bool write(std::FILE* file, const std::pair<TFirst, TSecond>& value)
+    {
+      return serializer<TFirst>::write(file, value.first)
+        && serializer<TSecond>::write(file, value.second);
+    }
+
+    static bool read(std::FILE* file, std::pair<TFirst, TSecond>& value)
+    {
+      return serializer<TFirst>::read(file, value.first)
+        && serializer<TSecond>::read(file, value.second);
+    }
+  };
+
 
   namespace detail
   {
@@ -38,19 +121,78 @@ namespace linq
       static const bool value = true;
     };
 
+    // Enumerators that can report their size and reach any element by index
+    // declare random_access = true and provide size(), at(index) and
+    // seek(index). After seek(index) the next move_next() yields at(index).
+    template <typename TEnumerator, typename = void>
+    struct is_random_access : std::false_type
+    {
+    };
+
+    template <typename TEnumerator>
+    struct is_random_access<TEnumerator, typename std::enable_if<TEnumerator::random_access>::type> : std::true_type
+    {
+    };
+
+    // Enumerators that yield their elements sorted declare ordered = true and
+    // provide find_first(result) and find_last(result), which locate the
+    // first or last element without sorting everything.
+    template <typename TEnumerator, typename = void>
+    struct is_ordered : std::false_type
+    {
+    };
+
+    template <typename TEnumerator>
+    struct is_ordered<TEnumerator, typename std::enable_if<TEnumerator::ordered>::type> : std::true_type
+    {
+    };
+
+    template <typename TSignature, typename = void>
+    struct is_const_callable : std::false_type
+    {
+    };
+
+    template <typename TFunction, typename... TArgs>
+    struct is_const_callable<TFunction(TArgs...), decltype(void(std::declval<const TFunction&>()(std::declval<TArgs>()...)))> : std::true_type
+    {
+    };
+
+    // A selector, predicate or comparer borrowed from a query plan. It points
+    // at the plan's copy and shares ownership of the plan, so cursors never
+    // copy callables and never outlive what they point at.
+    template <typename TFunction>
+    class SharedCallable
+    {
+    public:
+      SharedCallable(const std::shared_ptr<const void>& owner, const TFunction& function)
+        : _function(owner, &function)
+      {
+      }
+
+      template <typename... TArgs>
+      decltype(auto) operator()(TArgs&&... args) const
+      {
+        static_assert(is_const_callable<TFunction(TArgs&&...)>::value, "Every cursor of a query plan shares its selectors, so they must be callable as const. Mutable lambdas cannot be used with plan().");
+        return (*_function)(std::forward<TArgs>(args)...);
+      }
+    private:
+      std::shared_ptr<const TFunction> _function;
+    };
+
     template <typename TCollection>
   	struct SourceEnumerator
   	{
       using const_iterator = typename TCollection::const_iterator;
       using value_type = typename std::iterator_traits<const_iterator>::value_type;
+      static const bool random_access = std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<const_iterator>::iterator_category>::value;
 
   	  explicit SourceEnumerator(const TCollection& collection)
-  	    : _collection(collection), _started(false)
+  	    : _collection(std::make_shared<const TCollection>(collection)), _started(false), _offset(0)
   	  {
   	  }
 
   	  explicit SourceEnumerator(TCollection&& collection)
-  	    : _collection(collection), _started(false)
+  	    : _collection(std::make_shared<const TCollection>(std::move(collection))), _started(false), _offset(0)
   	  {
   	  }
 
@@ -59,8 +201,8 @@ namespace linq
   	    if (!_started)
   	    {
   	      _started = true;
-          _current = begin(_collection);
-          _end = end(_collection);
+          _current = std::next(begin(*_collection), _offset);
+          _end = end(*_collection);
   	    }
         else
         {
@@ -83,20 +225,110 @@ namespace linq
       void reset()
   	  {
         _started = false;
+        _offset = 0;
   	  }
+
+      size_t size() const
+      {
+        return static_cast<size_t>(std::distance(begin(*_collection), end(*_collection)));
+      }
+
+      const value_type& at(size_t index) const
+      {
+        return *std::next(begin(*_collection), index);
+      }
+
+      void seek(size_t index)
+      {
+        auto count = size();
+        _started = false;
+        _offset = index < count ? index : count;
+      }
+
+      // Shares the collection but starts from the beginning, wherever this
+      // enumerator has got to.
+      auto borrow(const std::shared_ptr<const void>&) const
+      {
+        auto result = *this;
+        result.reset();
+        return result;
+      }
   	private:
-      TCollection _collection;
+      // Shared and never modified, so copies of the enumerator do not copy the collection.
+      std::shared_ptr<const TCollection> _collection;
   	  bool _started;
+      size_t _offset;
   	  const_iterator _current;
   	  const_iterator _end;
   	};
 
+    // Enumerates a collection it owns outright. select_many uses it for its
+    // inner collections, which are never shared with a query plan and so do
+    // not need the shared ownership SourceEnumerator keeps.
+    template <typename TCollection>
+    struct OwnedSourceEnumerator
+    {
+      using const_iterator = typename TCollection::const_iterator;
+      using value_type = typename std::iterator_traits<const_iterator>::value_type;
+
+      explicit OwnedSourceEnumerator(TCollection&& collection)
+        : _collection(std::move(collection)), _started(false), _position(0)
+      {
+      }
+
+      // The iterators point into the collection, so a copy finds its place
+      // again in its own.
+      OwnedSourceEnumerator(const OwnedSourceEnumerator<TCollection>& other)
+        : _collection(other._collection), _started(other._started), _position(other._position)
+      {
+        if (_started)
+        {
+          _current = std::next(begin(_collection), _position);
+          _end = end(_collection);
+        }
+      }
+
+      bool move_next()
+      {
+        if (!_started)
+        {
+          _started = true;
+          _current = begin(_collection);
+          _end = end(_collection);
+        }
+        else
+        {
+          if (_current == _end)
+            return false;
+          ++_current;
+          ++_position;
+        }
+        return _current != _end;
+      }
+
+      const value_type& current() const
+      {
+        if (!_started)
+          throw invalid_operation();
+        if (_current == _end)
+          throw invalid_operation();
+        return *_current;
+      }
+    private:
+      TCollection _collection;
+      bool _started;
+      size_t _position;
+      const_iterator _current;
+      const_iterator _end;
+    };
+
     template <typename TFirst, typename TSecond>
     struct ConcatEnumerator
     {
       using first_type = typename TFirst::value_type;
       using second_type = typename TSecond::value_type;
       using value_type = typename std::enable_if<same<first_type, second_type>::value, first_type>::type;
+      static const bool random_access = is_random_access<TFirst>::value && is_random_access<TSecond>::value;
 
       ConcatEnumerator(TFirst first, TSecond second)
         : _first(first), _first_has_current(false), _second(second), _second_has_current(false)
@@ -136,6 +368,41 @@ namespace linq
         _first_has_current = false;
         _second_has_current = false;
   	  }
+
+      size_t size() const
+      {
+        return _first.size() + _second.size();
+      }
+
+      decltype(auto) at(size_t index) const
+      {
+        auto count = _first.size();
+        return index < count ? _first.at(index) : _second.at(index - count);
+      }
+
+      void seek(size_t index)
+      {
+        auto count = _first.size();
+        if (index < count)
+        {
+          _first.seek(index);
+          _second.reset();
+        }
+        else
+        {
+          _first.seek(count);
+          _second.seek(index - count);
+        }
+        _first_has_current = false;
+        _second_has_current = false;
+      }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto first = _first.borrow(owner);
+        auto second = _second.borrow(owner);
+        return ConcatEnumerator<decltype(first), decltype(second)>(first, second);
+      }
     private:
       TFirst _first;
       bool _first_has_current;
@@ -143,155 +410,499 @@ namespace linq
       bool _second_has_current;
     };
 
-    template <typename TSelector, typename TEnumerator>
-    struct SelectEnumerator
+    struct PairSelector
     {
-      using TSource = typename TEnumerator::value_type;
-      using value_type = typename std::decay<decltype(std::declval<TSelector>()(std::declval<TSource>()))>::type;
-
-      SelectEnumerator(const TEnumerator& enumerator, TSelector resultSelector)
-        : _enumerator(enumerator), _resultSelector(resultSelector)
+      template <typename TFirst, typename TSecond>
+      std::pair<TFirst, TSecond> operator()(const TFirst& first, const TSecond& second) const
       {
+        return std::make_pair(first, second);
       }
+    };
 
-      SelectEnumerator(TEnumerator&& enumerator, TSelector resultSelector)
-        : _enumerator(enumerator), _resultSelector(resultSelector)
+    template <typename TFirst, typename TSecond, typename TResultSelector>
+    struct ZipEnumerator
+    {
+      using first_type = typename TFirst::value_type;
+      using second_type = typename TSecond::value_type;
+      using value_type = typename std::decay<decltype(std::declval<TResultSelector>()(std::declval<first_type>(), std::declval<second_type>()))>::type;
+      // A mutable selector has to see the elements in order, so it is only
+      // reached by index when it can be called as const.
+      static const bool random_access = is_random_access<TFirst>::value && is_random_access<TSecond>::value
+        && is_const_callable<TResultSelector(first_type, second_type)>::value;
+
+      ZipEnumerator(TFirst first, TSecond second, TResultSelector resultSelector)
+        : _first(first), _second(second), _resultSelector(resultSelector), _current()
       {
       }
 
   	  bool move_next()
   	  {
-        auto value = _enumerator.move_next();
-        if (value)
-        {
-          _has_current = true;
-          _current = _resultSelector(_enumerator.current());
-        }
-        else
+        if (_first.move_next() && _second.move_next())
         {
-          _has_current = false;
-          _current = value_type{};
+          _current = _resultSelector(_first.current(), _second.current());
+          return true;
         }
-        return value;
+        _current = value_type{};
+        return false;
   	  }
 
-  	  value_type current() const
+  	  const value_type& current() const
   	  {
         return _current;
   	  }
 
       void reset()
   	  {
-        _enumerator.reset();
+        _first.reset();
+        _second.reset();
   	  }
+
+      size_t size() const
+      {
+        auto first = _first.size();
+        auto second = _second.size();
+        return first < second ? first : second;
+      }
+
+      value_type at(size_t index) const
+      {
+        return _resultSelector(_first.at(index), _second.at(index));
+      }
+
+      void seek(size_t index)
+      {
+        _first.seek(index);
+        _second.seek(index);
+      }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto first = _first.borrow(owner);
+        auto second = _second.borrow(owner);
+        return ZipEnumerator<decltype(first), decltype(second), SharedCallable<TResultSelector>>(first, second, SharedCallable<TResultSelector>(owner, _resultSelector));
+      }
     private:
-      bool _has_current;
+      TFirst _first;
+      TSecond _second;
+      TResultSelector _resultSelector;
       value_type _current;
-      TEnumerator _enumerator;
-      TSelector _resultSelector;
     };
 
-    template <typename TSelector, typename TEnumerator>
-    struct SelectManyEnumerator
+    template <typename TEnumerator>
+    struct PairwiseEnumerator
     {
       using source_type = typename TEnumerator::value_type;
-      using collection_type = typename std::decay<typename std::result_of<TSelector(source_type)>::type>::type;
-      using value_type = typename std::decay<decltype(*begin(std::declval<collection_type>()))>::type;
-
-      SelectManyEnumerator(const TEnumerator& enumerator, TSelector resultSelector)
-        : _enumerator(enumerator), _resultSelector(resultSelector), _current(nullptr)
-      {
-      }
+      using value_type = std::pair<source_type, source_type>;
 
-      SelectManyEnumerator(TEnumerator&& enumerator, TSelector resultSelector)
-        : _enumerator(enumerator), _resultSelector(resultSelector), _current(nullptr)
+      PairwiseEnumerator(const TEnumerator& enumerator)
+        : _enumerator(enumerator), _started(false), _current()
       {
       }
 
-      SelectManyEnumerator(const SelectManyEnumerator<TSelector, TEnumerator>& other)
-        : _enumerator(other._enumerator), _resultSelector(other._resultSelector), _current(other._current ? std::make_unique<SourceEnumerator<collection_type>>(*other._current) : std::unique_ptr<SourceEnumerator<collection_type>>(nullptr))
+      PairwiseEnumerator(TEnumerator&& enumerator)
+        : _enumerator(enumerator), _started(false), _current()
       {
       }
 
   	  bool move_next()
   	  {
-        if (_current)
+        if (!_started)
         {
-          if (_current->move_next())
-            return true;
-          _current = nullptr;
+          _started = true;
+          if (!_enumerator.move_next())
+            return false;
+          _current.second = _enumerator.current();
         }
-        while (_enumerator.move_next())
+        if (!_enumerator.move_next())
         {
-          auto value = _enumerator.current();
-          auto source = _resultSelector(value);
-          _current = std::make_unique<SourceEnumerator<collection_type>>(source);
-          if (_current->move_next())
-          {
-            return true;
-          }
-          _current = nullptr;
+          _current = value_type{};
+          return false;
         }
-        return false;
+        _current.first = std::move(_current.second);
+        _current.second = _enumerator.current();
+        return true;
   	  }
 
   	  const value_type& current() const
   	  {
-        if (_current)
-        {
-          return _current->current();
-        }
-        throw invalid_operation();
+        return _current;
   	  }
 
       void reset()
   	  {
         _enumerator.reset();
-        _current = nullptr;
+        _started = false;
+        _current = value_type{};
   	  }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return PairwiseEnumerator<decltype(enumerator)>(std::move(enumerator));
+      }
     private:
       TEnumerator _enumerator;
-      TSelector _resultSelector;
-      std::unique_ptr<SourceEnumerator<collection_type>> _current;
+      bool _started;
+      value_type _current;
     };
 
-    template <typename TEnumerator>
-    struct TakeEnumerator
+    // Read-only view of one window. It points into the enumerator's buffer and
+    // is only valid until the next call to move_next() or reset().
+    template <typename T>
+    struct WindowView
     {
-      using value_type = typename TEnumerator::value_type;
+      using value_type = T;
+      using const_iterator = const T*;
 
-      TakeEnumerator(const TEnumerator& enumerator, size_t count)
-        : _enumerator(enumerator), _count(count)
+      WindowView()
+        : _begin(nullptr), _size(0)
       {
       }
 
-      TakeEnumerator(TEnumerator&& enumerator, size_t count)
-        : _enumerator(enumerator), _count(count)
+      WindowView(const T* begin, size_t size)
+        : _begin(begin), _size(size)
       {
       }
 
-  	  bool move_next()
-  	  {
-        if (_i > _count)
-          return false;
-        ++_i;
-        if (_i > _count)
-          return false;
-        return _enumerator.move_next();
-  	  }
+      const_iterator begin() const
+      {
+        return _begin;
+      }
 
-  	  const value_type& current() const
-  	  {
-        if (_i > _count)
-          throw invalid_operation();
-        return _enumerator.current();
-  	  }
+      const_iterator end() const
+      {
+        return _begin + _size;
+      }
 
-      void reset()
+      size_t size() const
+      {
+        return _size;
+      }
+
+      const T& operator[](size_t index) const
+      {
+        return _begin[index];
+      }
+    private:
+      const T* _begin;
+      size_t _size;
+    };
+
+    template <typename TEnumerator>
+    struct WindowEnumerator
+    {
+      using source_type = typename TEnumerator::value_type;
+      using value_type = WindowView<source_type>;
+
+      WindowEnumerator(const TEnumerator& enumerator, size_t size)
+        : _enumerator(enumerator), _size(size), _position(0), _filled(0)
+      {
+      }
+
+      WindowEnumerator(TEnumerator&& enumerator, size_t size)
+        : _enumerator(enumerator), _size(size), _position(0), _filled(0)
+      {
+      }
+
+      // Every element is written twice, size slots apart, so the latest window
+      // is always the contiguous range [_position, _position + _size).
+  	  bool move_next()
+  	  {
+        if (_size == 0)
+          return false;
+        if (_buffer.empty())
+          _buffer.resize(_size * 2);
+        while (_enumerator.move_next())
+        {
+          _buffer[_position] = _enumerator.current();
+          _buffer[_position + _size] = _buffer[_position];
+          _position = (_position + 1) % _size;
+          if (++_filled >= _size)
+          {
+            _current = value_type{_buffer.data() + _position, _size};
+            return true;
+          }
+        }
+        _current = value_type{};
+        return false;
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        return _current;
+  	  }
+
+      void reset()
+  	  {
+        _enumerator.reset();
+        _position = 0;
+        _filled = 0;
+        _current = value_type{};
+  	  }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return WindowEnumerator<decltype(enumerator)>(std::move(enumerator), _size);
+      }
+    private:
+      TEnumerator _enumerator;
+      size_t _size;
+      size_t _position;
+      size_t _filled;
+      std::vector<source_type> _buffer;
+      value_type _current;
+    };
+
+    template <typename TAccumulate, typename TAccumulator, typename TEnumerator>
+    struct ScanEnumerator
+    {
+      using value_type = TAccumulate;
+
+      ScanEnumerator(const TEnumerator& enumerator, TAccumulate seed, TAccumulator accumulator)
+        : _enumerator(enumerator), _seed(seed), _accumulator(accumulator), _current(seed)
+      {
+      }
+
+      ScanEnumerator(TEnumerator&& enumerator, TAccumulate seed, TAccumulator accumulator)
+        : _enumerator(enumerator), _seed(seed), _accumulator(accumulator), _current(seed)
+      {
+      }
+
+  	  bool move_next()
+  	  {
+        if (!_enumerator.move_next())
+          return false;
+        _current = _accumulator(_current, _enumerator.current());
+        return true;
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        return _current;
+  	  }
+
+      void reset()
+  	  {
+        _enumerator.reset();
+        _current = _seed;
+  	  }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return ScanEnumerator<TAccumulate, SharedCallable<TAccumulator>, decltype(enumerator)>(std::move(enumerator), _seed, SharedCallable<TAccumulator>(owner, _accumulator));
+      }
+    private:
+      TEnumerator _enumerator;
+      TAccumulate _seed;
+      TAccumulator _accumulator;
+      value_type _current;
+    };
+
+    template <typename TSelector, typename TEnumerator>
+    struct SelectEnumerator
+    {
+      using TSource = typename TEnumerator::value_type;
+      using value_type = typename std::decay<decltype(std::declval<TSelector>()(std::declval<TSource>()))>::type;
+      // A mutable selector has to see the elements in order, so it is only
+      // reached by index when it can be called as const.
+      static const bool random_access = is_random_access<TEnumerator>::value && is_const_callable<TSelector(TSource)>::value;
+
+      SelectEnumerator(const TEnumerator& enumerator, TSelector resultSelector)
+        : _has_current(false), _current(), _enumerator(enumerator), _resultSelector(resultSelector)
+      {
+      }
+
+      SelectEnumerator(TEnumerator&& enumerator, TSelector resultSelector)
+        : _has_current(false), _current(), _enumerator(enumerator), _resultSelector(resultSelector)
+      {
+      }
+
+  	  bool move_next()
+  	  {
+        auto value = _enumerator.move_next();
+        if (value)
+        {
+          _has_current = true;
+          _current = _resultSelector(_enumerator.current());
+        }
+        else
+        {
+          _has_current = false;
+          _current = value_type{};
+        }
+        return value;
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        return _current;
+  	  }
+
+      void reset()
+  	  {
+        _enumerator.reset();
+  	  }
+
+      size_t size() const
+      {
+        return _enumerator.size();
+      }
+
+      value_type at(size_t index) const
+      {
+        return _resultSelector(_enumerator.at(index));
+      }
+
+      void seek(size_t index)
+      {
+        _enumerator.seek(index);
+      }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return SelectEnumerator<SharedCallable<TSelector>, decltype(enumerator)>(std::move(enumerator), SharedCallable<TSelector>(owner, _resultSelector));
+      }
+    private:
+      bool _has_current;
+      value_type _current;
+      TEnumerator _enumerator;
+      TSelector _resultSelector;
+    };
+
+    template <typename TSelector, typename TEnumerator>
+    struct SelectManyEnumerator
+    {
+      using source_type = typename TEnumerator::value_type;
+      using collection_type = typename std::decay<typename std::result_of<TSelector(source_type)>::type>::type;
+      using value_type = typename std::decay<decltype(*begin(std::declval<collection_type>()))>::type;
+
+      SelectManyEnumerator(const TEnumerator& enumerator, TSelector resultSelector)
+        : _enumerator(enumerator), _resultSelector(resultSelector), _current(nullptr)
+      {
+      }
+
+      SelectManyEnumerator(TEnumerator&& enumerator, TSelector resultSelector)
+        : _enumerator(enumerator), _resultSelector(resultSelector), _current(nullptr)
+      {
+      }
+
+      SelectManyEnumerator(const SelectManyEnumerator<TSelector, TEnumerator>& other)
+        : _enumerator(other._enumerator), _resultSelector(other._resultSelector), _current(other._current ? std::make_unique<OwnedSourceEnumerator<collection_type>>(*other._current) : std::unique_ptr<OwnedSourceEnumerator<collection_type>>(nullptr))
+      {
+      }
+
+  	  bool move_next()
+  	  {
+        if (_current)
+        {
+          if (_current->move_next())
+            return true;
+          _current = nullptr;
+        }
+        while (_enumerator.move_next())
+        {
+          auto value = _enumerator.current();
+          auto source = _resultSelector(value);
+          _current = std::make_unique<OwnedSourceEnumerator<collection_type>>(std::move(source));
+          if (_current->move_next())
+          {
+            return true;
+          }
+          _current = nullptr;
+        }
+        return false;
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        if (_current)
+        {
+          return _current->current();
+        }
+        throw invalid_operation();
+  	  }
+
+      void reset()
+  	  {
+        _enumerator.reset();
+        _current = nullptr;
+  	  }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return SelectManyEnumerator<SharedCallable<TSelector>, decltype(enumerator)>(std::move(enumerator), SharedCallable<TSelector>(owner, _resultSelector));
+      }
+    private:
+      TEnumerator _enumerator;
+      TSelector _resultSelector;
+      std::unique_ptr<OwnedSourceEnumerator<collection_type>> _current;
+    };
+
+    template <typename TEnumerator>
+    struct TakeEnumerator
+    {
+      using value_type = typename TEnumerator::value_type;
+      static const bool random_access = is_random_access<TEnumerator>::value;
+
+      TakeEnumerator(const TEnumerator& enumerator, size_t count)
+        : _enumerator(enumerator), _count(count), _i(0)
+      {
+      }
+
+      TakeEnumerator(TEnumerator&& enumerator, size_t count)
+        : _enumerator(enumerator), _count(count), _i(0)
+      {
+      }
+
+  	  bool move_next()
+  	  {
+        if (_i > _count)
+          return false;
+        ++_i;
+        if (_i > _count)
+          return false;
+        return _enumerator.move_next();
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        if (_i > _count)
+          throw invalid_operation();
+        return _enumerator.current();
+  	  }
+
+      void reset()
   	  {
         _enumerator.reset();
         _i = 0;
   	  }
+
+      size_t size() const
+      {
+        auto count = _enumerator.size();
+        return count < _count ? count : _count;
+      }
+
+      decltype(auto) at(size_t index) const
+      {
+        return _enumerator.at(index);
+      }
+
+      void seek(size_t index)
+      {
+        _enumerator.seek(index);
+        _i = index < _count ? index : _count;
+      }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return TakeEnumerator<decltype(enumerator)>(std::move(enumerator), _count);
+      }
     private:
       TEnumerator _enumerator;
       size_t _count;
@@ -302,6 +913,7 @@ namespace linq
     struct SkipEnumerator
     {
       using value_type = typename TEnumerator::value_type;
+      static const bool random_access = is_random_access<TEnumerator>::value;
 
       SkipEnumerator(const TEnumerator& enumerator, size_t count)
         : _enumerator(enumerator), _count(count), _started(false)
@@ -318,15 +930,7 @@ namespace linq
         if (!_started)
         {
           _started = true;
-          size_t i = 0;
-          bool value;
-          while (value = _enumerator.move_next())
-          {
-            ++i;
-            if (i > _count)
-              break;
-          }
-          return value;
+          return skip(is_random_access<TEnumerator>{});
         }
         return _enumerator.move_next();
   	  }
@@ -343,115 +947,890 @@ namespace linq
         _enumerator.reset();
         _started = false;
   	  }
+
+      size_t size() const
+      {
+        auto count = _enumerator.size();
+        return count > _count ? count - _count : 0;
+      }
+
+      decltype(auto) at(size_t index) const
+      {
+        return _enumerator.at(offset(index));
+      }
+
+      void seek(size_t index)
+      {
+        _enumerator.seek(offset(index));
+        _started = true;
+      }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return SkipEnumerator<decltype(enumerator)>(std::move(enumerator), _count);
+      }
     private:
+      // Saturates rather than wrapping, since seeking past the end of the
+      // source already leaves nothing to enumerate.
+      size_t offset(size_t index) const
+      {
+        return index > SIZE_MAX - _count ? SIZE_MAX : index + _count;
+      }
+
+      bool skip(std::true_type)
+      {
+        _enumerator.seek(_count);
+        return _enumerator.move_next();
+      }
+
+      bool skip(std::false_type)
+      {
+        size_t i = 0;
+        bool value;
+        while (value = _enumerator.move_next())
+        {
+          ++i;
+          if (i > _count)
+            break;
+        }
+        return value;
+      }
+
       TEnumerator _enumerator;
       size_t _count;
       bool _started;
     };
 
-    template <typename TPredicate, typename TEnumerator>
-    struct WhereEnumerator
+    template <typename TEnumerator>
+    struct ReverseEnumerator
+    {
+      using value_type = typename TEnumerator::value_type;
+      static const bool random_access = is_random_access<TEnumerator>::value;
+
+      ReverseEnumerator(const TEnumerator& enumerator)
+        : _enumerator(enumerator), _started(false), _index(0), _current()
+      {
+      }
+
+      ReverseEnumerator(TEnumerator&& enumerator)
+        : _enumerator(enumerator), _started(false), _index(0), _current()
+      {
+      }
+
+  	  bool move_next()
+  	  {
+        if (!_started)
+        {
+          _started = true;
+          _index = fill(is_random_access<TEnumerator>{});
+        }
+        if (_index == 0)
+        {
+          _current = value_type{};
+          return false;
+        }
+        --_index;
+        _current = element(_index, is_random_access<TEnumerator>{});
+        return true;
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        return _current;
+  	  }
+
+      void reset()
+  	  {
+        _enumerator.reset();
+        _buffer.clear();
+        _started = false;
+  	  }
+
+      size_t size() const
+      {
+        return _enumerator.size();
+      }
+
+      decltype(auto) at(size_t index) const
+      {
+        return _enumerator.at(_enumerator.size() - 1 - index);
+      }
+
+      void seek(size_t index)
+      {
+        auto count = _enumerator.size();
+        _index = index < count ? count - index : 0;
+        _started = true;
+      }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return ReverseEnumerator<decltype(enumerator)>(std::move(enumerator));
+      }
+    private:
+      // Random access sources are read back to front in place; anything else
+      // has to be buffered first.
+      size_t fill(std::true_type)
+      {
+        return _enumerator.size();
+      }
+
+      size_t fill(std::false_type)
+      {
+        _buffer.clear();
+        while (_enumerator.move_next())
+        {
+          _buffer.emplace_back(_enumerator.current());
+        }
+        return _buffer.size();
+      }
+
+      value_type element(size_t index, std::true_type)
+      {
+        return _enumerator.at(index);
+      }
+
+      value_type element(size_t index, std::false_type)
+      {
+        return std::move(_buffer[index]);
+      }
+
+      TEnumerator _enumerator;
+      bool _started;
+      size_t _index;
+      value_type _current;
+      std::vector<value_type> _buffer;
+    };
+
+    template <typename TPredicate, typename TEnumerator>
+    struct WhereEnumerator
+    {
+      using value_type = typename TEnumerator::value_type;
+
+      WhereEnumerator(const TEnumerator& enumerator, TPredicate predicate)
+        : _enumerator(enumerator), _predicate(predicate)
+      {
+      }
+
+      WhereEnumerator(TEnumerator&& enumerator, TPredicate predicate)
+        : _enumerator(enumerator), _predicate(predicate)
+      {
+      }
+
+  	  bool move_next()
+  	  {
+        while (_enumerator.move_next())
+        {
+          if (_predicate(_enumerator.current()))
+            return true;
+        }
+        return false;
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        return _enumerator.current();
+  	  }
+
+      void reset()
+  	  {
+        _enumerator.reset();
+  	  }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        return WhereEnumerator<SharedCallable<TPredicate>, decltype(enumerator)>(std::move(enumerator), SharedCallable<TPredicate>(owner, _predicate));
+      }
+    private:
+      TEnumerator _enumerator;
+      TPredicate _predicate;
+    };
+
+    // A sorted run written to a temporary file. Without a directory it is an
+    // anonymous std::tmpfile(); otherwise a uniquely named file in directory
+    // that is deleted again when the run is destroyed.
+    template <typename T>
+    class SpillRun
+    {
+    public:
+      explicit SpillRun(const std::string& directory)
+        : _file(nullptr)
+      {
+        if (directory.empty())
+          _file = std::tmpfile();
+        else
+          open(directory);
+        if (!_file)
+          throw std::runtime_error("Unable to create a temporary file to spill to.");
+      }
+
+      SpillRun(SpillRun<T>&& other)
+        : _file(other._file), _path(std::move(other._path))
+      {
+        other._file = nullptr;
+        other._path.clear();
+      }
+
+      SpillRun<T>& operator=(SpillRun<T>&& other)
+      {
+        std::swap(_file, other._file);
+        std::swap(_path, other._path);
+        return *this;
+      }
+
+      ~SpillRun()
+      {
+        if (!_file)
+          return;
+        std::fclose(_file);
+        if (!_path.empty())
+          std::remove(_path.c_str());
+      }
+
+      void write(const T& value)
+      {
+        if (!serializer<T>::write(_file, value))
+          throw std::runtime_error("Unable to write to a temporary spill file.");
+      }
+
+      // Writes are buffered, so a full disk often only shows up here; rewind
+      // itself would flush and then clear the error.
+      void rewind()
+      {
+        if (std::fflush(_file) != 0 || std::ferror(_file))
+          throw std::runtime_error("Unable to write to a temporary spill file.");
+        std::rewind(_file);
+      }
+
+      // False only at a clean end of the run; a read error or a truncated
+      // record throws rather than silently dropping entries.
+      bool read(T& value)
+      {
+        auto next = std::fgetc(_file);
+        if (next == EOF && !std::ferror(_file))
+          return false;
+        if (next == EOF || std::ungetc(next, _file) == EOF || !serializer<T>::read(_file, value))
+          throw std::runtime_error("Unable to read back a temporary spill file.");
+        return true;
+      }
+    private:
+      void open(const std::string& directory)
+      {
+        static std::atomic<unsigned long long> counter{0};
+        for (int attempt = 0; attempt < 16 && !_file; ++attempt)
+        {
+          auto path = directory + "/linqpp-"
+            + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-"
+            + std::to_string(reinterpret_cast<uintptr_t>(this)) + "-"
+            + std::to_string(counter++) + ".run";
+          if (auto existing = std::fopen(path.c_str(), "rb"))
+          {
+            std::fclose(existing);
+            continue;
+          }
+          _file = std::fopen(path.c_str(), "w+b");
+          if (_file)
+            _path = path;
+        }
+      }
+
+      std::FILE* _file;
+      std::string _path;
+    };
+
+    template <typename TKeySelector, typename TComparer, typename TEnumerator>
+    struct OrderByEnumerator
+    {
+      using value_type = typename TEnumerator::value_type;
+      using key_type = typename std::decay<decltype(std::declval<TKeySelector>()(std::declval<value_type>()))>::type;
+      using entry_type = std::pair<key_type, value_type>;
+      static const bool ordered = true;
+
+      OrderByEnumerator(const TEnumerator& enumerator, TKeySelector keySelector, TComparer comp)
+        : _enumerator(enumerator), _keySelector(keySelector), _comp(comp), _memoryBudget(0), _spillDirectory(), _index(-1), _lastKey(), _current()
+      {
+      }
+
+      OrderByEnumerator(TEnumerator&& enumerator, TKeySelector keySelector, TComparer comp)
+        : _enumerator(enumerator), _keySelector(keySelector), _comp(comp), _memoryBudget(0), _spillDirectory(), _index(-1), _lastKey(), _current()
+      {
+      }
+
+      // A copy never shares spilled runs; it sorts again on first use.
+      OrderByEnumerator(const OrderByEnumerator<TKeySelector, TComparer, TEnumerator>& other)
+        : _enumerator(other._enumerator), _keySelector(other._keySelector), _comp(other._comp), _memoryBudget(other._memoryBudget), _spillDirectory(other._spillDirectory), _index(-1), _lastKey(), _current()
+      {
+      }
+
+  	  bool move_next()
+  	  {
+        if (_index == -1)
+        {
+          sort();
+          _index = 0;
+        }
+        else if (static_cast<size_t>(_index) < _sortedList.size())
+        {
+          ++_index;
+        }
+        if (!_runs.empty())
+          return merge_next(spillable{});
+        return static_cast<size_t>(_index) < _sortedList.size();
+  	  }
+
+  	  const value_type& current() const
+  	  {
+        if (!_runs.empty())
+          return _current;
+        return _sortedList[static_cast<size_t>(_index)];
+  	  }
+
+      void reset()
+  	  {
+        _enumerator.reset();
+        _index = -1;
+        _sortedList.clear();
+        _levels.clear();
+        _runs.clear();
+        _heads.clear();
+        _heap.clear();
+  	  }
+
+      // Once more than bytes worth of entries are buffered they are sorted and
+      // written out as a run in directory. Runs are merged lazily as the
+      // caller advances. Zero, the default, keeps everything in memory.
+      void set_memory_budget(size_t bytes, const std::string& directory)
+      {
+        _memoryBudget = bytes;
+        _spillDirectory = directory;
+      }
+
+      // Single pass for the smallest key; ties go to the earliest element,
+      // matching the stable sort.
+      bool find_first(value_type& result)
+      {
+        bool found = false;
+        key_type best{};
+        while (_enumerator.move_next())
+        {
+          auto current = _enumerator.current();
+          auto key = _keySelector(current);
+          if (!found || _comp(key, best))
+          {
+            found = true;
+            best = std::move(key);
+            result = std::move(current);
+          }
+        }
+        return found;
+      }
+
+      // Single pass for the largest key; ties go to the latest element.
+      bool find_last(value_type& result)
+      {
+        bool found = false;
+        key_type best{};
+        while (_enumerator.move_next())
+        {
+          auto current = _enumerator.current();
+          auto key = _keySelector(current);
+          if (!found || !_comp(key, best))
+          {
+            found = true;
+            best = std::move(key);
+            result = std::move(current);
+          }
+        }
+        return found;
+      }
+
+      auto borrow(const std::shared_ptr<const void>& owner) const
+      {
+        auto enumerator = _enumerator.borrow(owner);
+        auto result = OrderByEnumerator<SharedCallable<TKeySelector>, SharedCallable<TComparer>, decltype(enumerator)>(std::move(enumerator), SharedCallable<TKeySelector>(owner, _keySelector), SharedCallable<TComparer>(owner, _comp));
+        result.set_memory_budget(_memoryBudget, _spillDirectory);
+        return result;
+      }
+    private:
+      // Upper bound on the number of runs merged at once, and so on the runs
+      // kept at any one level.
+      static const size_t max_runs = 64;
+
+      // Only entries with a serializer can be written out; for anything else
+      // the spilling code is never instantiated.
+      using spillable = std::integral_constant<bool, has_serializer<entry_type>::value>;
+
+      void sort()
+      {
+        std::vector<entry_type> buffer{};
+        while (_enumerator.move_next())
+        {
+          auto current = _enumerator.current();
+          auto key = _keySelector(current);
+          buffer.emplace_back(std::move(key), std::move(current));
+          if (_memoryBudget != 0 && buffer.size() * sizeof(entry_type) >= _memoryBudget)
+            spill(buffer, spillable{});
+        }
+        if (_levels.empty())
+        {
+          std::stable_sort(buffer.begin(), buffer.end(), [this](const entry_type& left, const entry_type& right)
+          {
+            return _comp(left.first, right.first);
+          });
+          _sortedList.reserve(buffer.size());
+          for (auto& elem : buffer)
+          {
+            _sortedList.emplace_back(std::move(elem.second));
+          }
+          return;
+        }
+        finish_spill(buffer, spillable{});
+      }
+
+      void spill(std::vector<entry_type>&, std::false_type)
+      {
+      }
+
+      void finish_spill(std::vector<entry_type>&, std::false_type)
+      {
+      }
+
+      bool merge_next(std::false_type)
+      {
+        return false;
+      }
+
+      // Folds the lowest levels up until a single merge can take every run,
+      // then lines the runs up in input order, oldest level first, so that
+      // the final merge stays stable.
+      void finish_spill(std::vector<entry_type>& buffer, std::true_type)
+      {
+        if (!buffer.empty())
+          spill(buffer, std::true_type{});
+        for (size_t level = 0; level + 1 < _levels.size() && run_count() > max_runs; ++level)
+        {
+          compact(level);
+        }
+        for (auto level = _levels.rbegin(); level != _levels.rend(); ++level)
+        {
+          for (auto& run : *level)
+          {
+            _runs.emplace_back(std::move(run));
+          }
+        }
+        _levels.clear();
+        start_merge();
+      }
+
+      bool merge_next(std::true_type)
+      {
+        return merge_next();
+      }
+
+      void spill(std::vector<entry_type>& buffer, std::true_type)
+      {
+        std::stable_sort(buffer.begin(), buffer.end(), [this](const entry_type& left, const entry_type& right)
+        {
+          return _comp(left.first, right.first);
+        });
+        if (_levels.empty())
+          _levels.emplace_back();
+        _levels[0].emplace_back(_spillDirectory);
+        for (auto& elem : buffer)
+        {
+          _levels[0].back().write(elem);
+        }
+        buffer.clear();
+        for (size_t level = 0; _levels[level].size() == max_runs; ++level)
+        {
+          compact(level);
+        }
+      }
+
+      // Merges the runs of one level into a single run on the next level up,
+      // so every entry is rewritten once per level rather than once per
+      // compaction. Runs on a higher level always hold earlier input.
+      void compact(size_t level)
+      {
+        if (_levels.size() == level + 1)
+          _levels.emplace_back();
+        _runs = std::move(_levels[level]);
+        _levels[level].clear();
+        if (_runs.size() == 1)
+        {
+          _levels[level + 1].emplace_back(std::move(_runs.back()));
+          _runs.clear();
+          return;
+        }
+        start_merge();
+        SpillRun<entry_type> merged{_spillDirectory};
+        while (merge_next())
+        {
+          merged.write(entry_type{std::move(_lastKey), std::move(_current)});
+        }
+        _runs.clear();
+        _levels[level + 1].emplace_back(std::move(merged));
+      }
+
+      size_t run_count() const
+      {
+        size_t count = 0;
+        for (auto& level : _levels)
+        {
+          count += level.size();
+        }
+        return count;
+      }
+
+      void start_merge()
+      {
+        _heads.resize(_runs.size());
+        _heap.clear();
+        for (size_t i = 0; i < _runs.size(); ++i)
+        {
+          _runs[i].rewind();
+          if (_runs[i].read(_heads[i]))
+            _heap.push_back(i);
+        }
+        std::make_heap(_heap.begin(), _heap.end(), [this](size_t left, size_t right) {return after(left, right);});
+      }
+
+      bool merge_next()
+      {
+        if (_heap.empty())
+          return false;
+        auto order = [this](size_t left, size_t right) {return after(left, right);};
+        std::pop_heap(_heap.begin(), _heap.end(), order);
+        auto run = _heap.back();
+        _lastKey = std::move(_heads[run].first);
+        _current = std::move(_heads[run].second);
+        if (_runs[run].read(_heads[run]))
+          std::push_heap(_heap.begin(), _heap.end(), order);
+        else
+          _heap.pop_back();
+        return true;
+      }
+
+      // Heap order: the smallest key on top, earlier runs first among equal
+      // keys so the merge is stable.
+      bool after(size_t left, size_t right) const
+      {
+        if (_comp(_heads[right].first, _heads[left].first))
+          return true;
+        if (_comp(_heads[left].first, _heads[right].first))
+          return false;
+        return right < left;
+      }
+
+      TEnumerator _enumerator;
+      TKeySelector _keySelector;
+      TComparer _comp;
+      size_t _memoryBudget;
+      std::string _spillDirectory;
+      int64_t _index;
+      std::vector<value_type> _sortedList;
+      std::vector<std::vector<SpillRun<entry_type>>> _levels;
+      std::vector<SpillRun<entry_type>> _runs;
+      std::vector<entry_type> _heads;
+      std::vector<size_t> _heap;
+      key_type _lastKey;
+      value_type _current;
+    };
+
+    // Lock-free single-producer/single-consumer queue. One slot is kept empty
+    // so that a full buffer can be told apart from an empty one.
+    template <typename T>
+    class SpscRingBuffer
+    {
+    public:
+      explicit SpscRingBuffer(size_t capacity)
+        : _slots(capacity + 1), _head(0), _tail(0)
+      {
+      }
+
+      bool try_push(T& value)
+      {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        auto next = (tail + 1) % _slots.size();
+        if (next == _head.load(std::memory_order_acquire))
+          return false;
+        _slots[tail] = std::move(value);
+        _tail.store(next, std::memory_order_release);
+        return true;
+      }
+
+      bool try_pop(T& value)
+      {
+        auto head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+          return false;
+        value = std::move(_slots[head]);
+        _head.store((head + 1) % _slots.size(), std::memory_order_release);
+        return true;
+      }
+
+      // Only meaningful on the consumer side.
+      bool empty() const
+      {
+        return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire);
+      }
+
+      // Only meaningful on the producer side.
+      bool full() const
+      {
+        return (_tail.load(std::memory_order_relaxed) + 1) % _slots.size() == _head.load(std::memory_order_acquire);
+      }
+    private:
+      std::vector<T> _slots;
+      std::atomic<size_t> _head;
+      std::atomic<size_t> _tail;
+    };
+
+    template <typename TEnumerator>
+    struct PipelinedEnumerator
     {
       using value_type = typename TEnumerator::value_type;
+      using batch_type = std::vector<value_type>;
 
-      WhereEnumerator(const TEnumerator& enumerator, TPredicate predicate)
-        : _enumerator(enumerator), _predicate(predicate)
+      PipelinedEnumerator(const TEnumerator& enumerator, size_t capacity, size_t batchSize)
+        : _enumerator(enumerator), _capacity(capacity ? capacity : 1), _batchSize(batchSize ? batchSize : 1), _position(0), _finished(false)
       {
       }
 
-      WhereEnumerator(TEnumerator&& enumerator, TPredicate predicate)
-        : _enumerator(enumerator), _predicate(predicate)
+      PipelinedEnumerator(TEnumerator&& enumerator, size_t capacity, size_t batchSize)
+        : _enumerator(enumerator), _capacity(capacity ? capacity : 1), _batchSize(batchSize ? batchSize : 1), _position(0), _finished(false)
+      {
+      }
+
+      // A copy never shares the running stage; it starts its own producer on first use.
+      PipelinedEnumerator(const PipelinedEnumerator<TEnumerator>& other)
+        : _enumerator(other._enumerator), _capacity(other._capacity), _batchSize(other._batchSize), _position(0), _finished(false)
       {
       }
 
   	  bool move_next()
   	  {
-        while (_enumerator.move_next())
+        if (_finished)
+          return false;
+        if (!_stage)
+          _stage = std::make_unique<Stage>(_enumerator, _capacity, _batchSize);
+        if (_position < _batch.size())
         {
-          if (_predicate(_enumerator.current()))
-            return true;
+          ++_position;
+          return true;
         }
-        return false;
+        _position = 0;
+        _batch.clear();
+        bool popped;
+        try
+        {
+          popped = _stage->pop(_batch);
+        }
+        catch (...)
+        {
+          // An upstream error ends the sequence just like running out does.
+          _stage = nullptr;
+          _finished = true;
+          throw;
+        }
+        if (!popped)
+        {
+          // The producer has finished; let its thread go rather than holding it until reset.
+          _batch.clear();
+          _stage = nullptr;
+          _finished = true;
+          return false;
+        }
+        _position = 1;
+        return true;
   	  }
 
   	  const value_type& current() const
   	  {
-        return _enumerator.current();
+        if (_position == 0)
+          throw invalid_operation();
+        return _batch[_position - 1];
   	  }
 
       void reset()
   	  {
-        _enumerator.reset();
+        _stage = nullptr;
+        _batch.clear();
+        _position = 0;
+        _finished = false;
   	  }
-    private:
-      TEnumerator _enumerator;
-      TPredicate _predicate;
-    };
 
-    template <typename TKeySelector, typename TComparer, typename TEnumerator>
-    struct OrderByEnumerator
-    {
-      using value_type = typename TEnumerator::value_type;
-      using key_type = typename std::decay<decltype(std::declval<TKeySelector>()(std::declval<value_type>()))>::type;
-
-      OrderByEnumerator(const TEnumerator& enumerator, TKeySelector keySelector, TComparer comp)
-        : _enumerator(enumerator), _keySelector(keySelector), _comp(comp), _index(-1)
+      auto borrow(const std::shared_ptr<const void>& owner) const
       {
+        auto enumerator = _enumerator.borrow(owner);
+        return PipelinedEnumerator<decltype(enumerator)>(std::move(enumerator), _capacity, _batchSize);
       }
-
-      OrderByEnumerator(TEnumerator&& enumerator, TKeySelector keySelector, TComparer comp)
-        : _enumerator(enumerator), _keySelector(keySelector), _comp(comp), _index(-1)
+    private:
+      // Runs a private copy of the upstream chain on its own thread and hands
+      // batches to the consumer through the ring buffer. A full buffer stalls
+      // the producer, which bounds the memory held between stages. Either side
+      // spins briefly when it has to wait and then parks on a condition
+      // variable, so an idle or abandoned stage does not hold a core.
+      class Stage
       {
-      }
+      public:
+        Stage(const TEnumerator& enumerator, size_t capacity, size_t batchSize)
+          : _enumerator(enumerator), _batchSize(batchSize), _queue(capacity), _done(false), _cancelled(false), _waiters(0)
+        {
+          _thread = std::thread([this] { produce(); });
+        }
 
-  	  bool move_next()
-  	  {
-        if (_index == -1)
+        ~Stage()
         {
-          std::map<key_type, value_type, TComparer> sort_map{_comp}; // TODO: add comparrer
-          while (_enumerator.move_next())
+          _cancelled.store(true, std::memory_order_relaxed);
+          notify();
+          _thread.join();
+        }
+
+        bool pop(batch_type& batch)
+        {
+          size_t spins = 0;
+          while (true)
           {
-            auto current = _enumerator.current();
-            auto key = _keySelector(current);
-            sort_map[key] = current;
+            if (_queue.try_pop(batch))
+            {
+              notify();
+              return true;
+            }
+            if (_done.load(std::memory_order_acquire))
+            {
+              if (_queue.try_pop(batch))
+                return true;
+              if (_error)
+                std::rethrow_exception(_error);
+              return false;
+            }
+            if (++spins < spin_count)
+            {
+              std::this_thread::yield();
+              continue;
+            }
+            park([this] { return !_queue.empty() || _done.load(std::memory_order_acquire); });
           }
-          for (auto elem : sort_map)
+        }
+      private:
+        static const size_t spin_count = 64;
+
+        void produce()
+        {
+          batch_type batch{};
+          try
           {
-            _sortedList.emplace_back(elem.second);
+            _enumerator.reset();
+            batch.reserve(_batchSize);
+            while (!_cancelled.load(std::memory_order_relaxed) && _enumerator.move_next())
+            {
+              batch.emplace_back(_enumerator.current());
+              if (batch.size() == _batchSize)
+              {
+                if (!push(batch))
+                  break;
+                batch = batch_type{};
+                batch.reserve(_batchSize);
+              }
+            }
           }
-          _index = 0;
-          return _sortedList.size() != _index;
+          catch (...)
+          {
+            _error = std::current_exception();
+          }
+          // Whatever was produced before the end, or before an exception, is
+          // still delivered ahead of the error.
+          if (!batch.empty())
+            push(batch);
+          _done.store(true, std::memory_order_release);
+          notify();
         }
-        else
+
+        bool push(batch_type& batch)
         {
-          auto size = _sortedList.size();
-          if (_index < size)
+          size_t spins = 0;
+          while (!_queue.try_push(batch))
           {
-            ++_index;
+            if (_cancelled.load(std::memory_order_relaxed))
+              return false;
+            if (++spins < spin_count)
+            {
+              std::this_thread::yield();
+              continue;
+            }
+            park([this] { return !_queue.full() || _cancelled.load(std::memory_order_relaxed); });
           }
-          return _index < size;
+          notify();
+          return true;
         }
-  	  }
 
-  	  const value_type& current() const
-  	  {
-        return _sortedList[static_cast<unsigned int>(_index)];
-  	  }
+        // The waiter count goes up under the lock and ahead of the final
+        // check of ready. Both sides update it with read-modify-writes, so a
+        // notifier that reads it before the increment has made its change
+        // visible to that check.
+        template <typename TReady>
+        void park(TReady ready)
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _waiters.fetch_add(1, std::memory_order_acq_rel);
+          _changed.wait(lock, ready);
+          _waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Only locks when the other side is parked, so the hand-off stays
+        // lock-free while both sides keep up. Taking the lock then orders the
+        // wake-up after the waiter's check of the queue, so a notification can
+        // never be lost.
+        void notify()
+        {
+          if (_waiters.fetch_add(0, std::memory_order_acq_rel) == 0)
+            return;
+          std::lock_guard<std::mutex> lock(_mutex);
+          _changed.notify_all();
+        }
+
+        TEnumerator _enumerator;
+        size_t _batchSize;
+        SpscRingBuffer<batch_type> _queue;
+        std::atomic<bool> _done;
+        std::atomic<bool> _cancelled;
+        std::exception_ptr _error;
+        std::atomic<int> _waiters;
+        std::mutex _mutex;
+        std::condition_variable _changed;
+        std::thread _thread;
+      };
 
-      void reset()
-  	  {
-        _index = -1;
-        _sortedList.clear();
-  	  }
-    private:
       TEnumerator _enumerator;
-      TKeySelector _keySelector;
-      TComparer _comp;
-      int64_t _index;
-      std::vector<value_type> _sortedList;
+      size_t _capacity;
+      size_t _batchSize;
+      std::unique_ptr<Stage> _stage;
+      batch_type _batch;
+      size_t _position;
+      bool _finished;
+    };
+
+    // Resets an enumerator when a terminal stops reading early, so stages such
+    // as pipelined() shut down instead of waiting on a consumer that is gone.
+    template <typename TEnumerator>
+    struct ResetOnExit
+    {
+      ~ResetOnExit()
+      {
+        enumerator.reset();
+      }
+
+      TEnumerator& enumerator;
     };
   }
 
+  template <typename Enumerator>
+  struct Query;
+
   template <typename Enumerator>
   struct Enumerable
   {
@@ -477,6 +1856,13 @@ namespace linq
       _enumerator.reset();
     }
 
+    // Freezes this pipeline into an immutable plan that any number of threads
+    // can open cursors on.
+    Query<Enumerator> plan() const
+    {
+      return Query<Enumerator>(_enumerator);
+    }
+
     std::vector<value_type> to_vector()
     {
       std::vector<value_type> result{};
@@ -489,6 +1875,119 @@ namespace linq
       return result;
     }
 
+    size_t count()
+    {
+      return count(detail::is_random_access<Enumerator>{});
+    }
+
+    value_type element_at(size_t index)
+    {
+      return element_at(index, detail::is_random_access<Enumerator>{});
+    }
+
+    value_type first()
+    {
+      value_type result{};
+      if (!try_first(result, detail::is_ordered<Enumerator>{}))
+        throw invalid_operation();
+      return result;
+    }
+
+    template <typename TPredicate>
+    value_type first(TPredicate predicate)
+    {
+      return where(predicate).first();
+    }
+
+    value_type first_or_default()
+    {
+      value_type result{};
+      try_first(result, detail::is_ordered<Enumerator>{});
+      return result;
+    }
+
+    template <typename TPredicate>
+    value_type first_or_default(TPredicate predicate)
+    {
+      return where(predicate).first_or_default();
+    }
+
+    value_type last()
+    {
+      value_type result{};
+      if (!try_last(result, detail::is_random_access<Enumerator>{}))
+        throw invalid_operation();
+      return result;
+    }
+
+    template <typename TPredicate>
+    value_type last(TPredicate predicate)
+    {
+      return where(predicate).last();
+    }
+
+    value_type last_or_default()
+    {
+      value_type result{};
+      try_last(result, detail::is_random_access<Enumerator>{});
+      return result;
+    }
+
+    template <typename TPredicate>
+    value_type last_or_default(TPredicate predicate)
+    {
+      return where(predicate).last_or_default();
+    }
+
+    // Reads at most two elements: throws if there are none or more than one.
+    value_type single()
+    {
+      _enumerator.reset();
+      detail::ResetOnExit<Enumerator> guard{_enumerator};
+      if (!_enumerator.move_next())
+        throw invalid_operation();
+      value_type result = _enumerator.current();
+      if (_enumerator.move_next())
+        throw invalid_operation();
+      return result;
+    }
+
+    template <typename TPredicate>
+    value_type single(TPredicate predicate)
+    {
+      return where(predicate).single();
+    }
+
+    value_type single_or_default()
+    {
+      _enumerator.reset();
+      detail::ResetOnExit<Enumerator> guard{_enumerator};
+      if (!_enumerator.move_next())
+        return value_type{};
+      value_type result = _enumerator.current();
+      if (_enumerator.move_next())
+        throw invalid_operation();
+      return result;
+    }
+
+    template <typename TPredicate>
+    value_type single_or_default(TPredicate predicate)
+    {
+      return where(predicate).single_or_default();
+    }
+
+    bool contains(const value_type& value)
+    {
+      _enumerator.reset();
+      detail::ResetOnExit<Enumerator> guard{_enumerator};
+      while (_enumerator.move_next())
+      {
+        if (_enumerator.current() == value)
+          return true;
+      }
+      return false;
+    }
+
     template <typename TSelector>
     auto select(TSelector resultSelector)
       -> Enumerable<detail::SelectEnumerator<TSelector, Enumerator>>
@@ -512,6 +2011,40 @@ namespace linq
       return Enumerable<detail::ConcatEnumerator<Enumerator, TEnumerator>>(enumerator);
     }
 
+    template <typename TEnumerator, typename TResultSelector>
+    auto zip(Enumerable<TEnumerator> other, TResultSelector resultSelector)
+      -> Enumerable<detail::ZipEnumerator<Enumerator, TEnumerator, TResultSelector>>
+    {
+      auto enumerator = detail::ZipEnumerator<Enumerator, TEnumerator, TResultSelector>(_enumerator, other._enumerator, resultSelector);
+      return Enumerable<detail::ZipEnumerator<Enumerator, TEnumerator, TResultSelector>>(enumerator);
+    }
+
+    template <typename TEnumerator>
+    auto zip(Enumerable<TEnumerator> other)
+    {
+      return zip(other, detail::PairSelector{});
+    }
+
+    Enumerable<detail::PairwiseEnumerator<Enumerator>> pairwise()
+    {
+      return Enumerable<detail::PairwiseEnumerator<Enumerator>>(detail::PairwiseEnumerator<Enumerator>(_enumerator));
+    }
+
+    // Sliding windows of exactly size elements. Each window is a view that is
+    // only valid until the next element is requested.
+    Enumerable<detail::WindowEnumerator<Enumerator>> window(size_t size)
+    {
+      return Enumerable<detail::WindowEnumerator<Enumerator>>(detail::WindowEnumerator<Enumerator>(_enumerator, size));
+    }
+
+    template <typename TAccumulate, typename TAccumulator>
+    auto scan(TAccumulate seed, TAccumulator accumulator)
+      -> Enumerable<detail::ScanEnumerator<TAccumulate, TAccumulator, Enumerator>>
+    {
+      auto enumerator = detail::ScanEnumerator<TAccumulate, TAccumulator, Enumerator>(_enumerator, seed, accumulator);
+      return Enumerable<detail::ScanEnumerator<TAccumulate, TAccumulator, Enumerator>>(enumerator);
+    }
+
     template <typename TPredicate>
     auto where(TPredicate predicate)
       -> Enumerable<detail::WhereEnumerator<TPredicate, Enumerator>>
@@ -528,6 +2061,24 @@ namespace linq
       return Enumerable<detail::OrderByEnumerator<TKeySelector, TComparer, Enumerator>>(enumerator);
     }
 
+    // Lets the preceding order_by spill sorted runs to temporary files once
+    // it buffers more than bytes. Runs go to directory when one is given and
+    // to std::tmpfile() otherwise; point it at real disk where the system
+    // temp directory is memory backed. Keys and values that are not
+    // trivially copyable need a linq::serializer specialization.
+    //
+    // The budget is counted as sizeof(std::pair<key, value>) per buffered
+    // element. Memory the key or value owns on the heap, such as the
+    // characters of a std::string, is not counted, so pick a smaller budget
+    // for such types.
+    Enumerable<Enumerator> memory_budget(size_t bytes, const std::string& directory = std::string{})
+    {
+      static_assert(detail::has_serializer<typename Enumerator::entry_type>::value, "Spilling needs a linq::serializer for both the key and the element type.");
+      auto enumerator = _enumerator;
+      enumerator.set_memory_budget(bytes, directory);
+      return Enumerable<Enumerator>(enumerator);
+    }
+
     Enumerable<detail::TakeEnumerator<Enumerator>> take(size_t count)
     {
       return Enumerable<detail::TakeEnumerator<Enumerator>>(detail::TakeEnumerator<Enumerator>(_enumerator, count));
@@ -537,13 +2088,152 @@ namespace linq
     {
       return Enumerable<detail::SkipEnumerator<Enumerator>>(detail::SkipEnumerator<Enumerator>(_enumerator, count));
     }
+
+    Enumerable<detail::ReverseEnumerator<Enumerator>> reverse()
+    {
+      return Enumerable<detail::ReverseEnumerator<Enumerator>>(detail::ReverseEnumerator<Enumerator>(_enumerator));
+    }
+
+    // Runs everything upstream of this call on a separate thread. Elements are
+    // passed downstream in order, in batches of batchSize, through a bounded
+    // queue holding at most capacity batches.
+    Enumerable<detail::PipelinedEnumerator<Enumerator>> async_stage(size_t capacity, size_t batchSize = 64)
+    {
+      return Enumerable<detail::PipelinedEnumerator<Enumerator>>(detail::PipelinedEnumerator<Enumerator>(_enumerator, capacity, batchSize));
+    }
+
+    Enumerable<detail::PipelinedEnumerator<Enumerator>> pipelined()
+    {
+      return async_stage(16);
+    }
   private:
+    size_t count(std::true_type)
+    {
+      return _enumerator.size();
+    }
+
+    size_t count(std::false_type)
+    {
+      size_t result = 0;
+      _enumerator.reset();
+      while (_enumerator.move_next())
+      {
+        ++result;
+      }
+      return result;
+    }
+
+    value_type element_at(size_t index, std::true_type)
+    {
+      if (index >= _enumerator.size())
+        throw invalid_operation();
+      return _enumerator.at(index);
+    }
+
+    value_type element_at(size_t index, std::false_type)
+    {
+      _enumerator.reset();
+      detail::ResetOnExit<Enumerator> guard{_enumerator};
+      while (_enumerator.move_next())
+      {
+        if (index-- == 0)
+          return _enumerator.current();
+      }
+      throw invalid_operation();
+    }
+
+    bool try_first(value_type& result, std::true_type)
+    {
+      _enumerator.reset();
+      detail::ResetOnExit<Enumerator> guard{_enumerator};
+      return _enumerator.find_first(result);
+    }
+
+    bool try_first(value_type& result, std::false_type)
+    {
+      _enumerator.reset();
+      detail::ResetOnExit<Enumerator> guard{_enumerator};
+      if (!_enumerator.move_next())
+        return false;
+      result = _enumerator.current();
+      return true;
+    }
+
+    bool try_last(value_type& result, std::true_type)
+    {
+      auto size = _enumerator.size();
+      if (size == 0)
+        return false;
+      result = _enumerator.at(size - 1);
+      return true;
+    }
+
+    bool try_last(value_type& result, std::false_type)
+    {
+      return scan_last(result, detail::is_ordered<Enumerator>{});
+    }
+
+    bool scan_last(value_type& result, std::true_type)
+    {
+      _enumerator.reset();
+      detail::ResetOnExit<Enumerator> guard{_enumerator};
+      return _enumerator.find_last(result);
+    }
+
+    bool scan_last(value_type& result, std::false_type)
+    {
+      _enumerator.reset();
+      if (!_enumerator.move_next())
+        return false;
+      result = _enumerator.current();
+      while (_enumerator.move_next())
+      {
+        result = _enumerator.current();
+      }
+      return true;
+    }
+
     Enumerator _enumerator;
 
     template <typename TEnumerator>
     friend struct Enumerable;
   };
 
+  // An immutable query definition. The pipeline is stored once; cursor()
+  // hands out an independent Enumerable whose stages borrow the plan's
+  // source and selectors rather than copying them, so opening one is cheap
+  // and many can run on different threads at once. Selectors must be const
+  // callable and safe to call concurrently for that to hold.
+  template <typename Enumerator>
+  struct Query
+  {
+    using cursor_type = decltype(std::declval<const Enumerator&>().borrow(std::declval<const std::shared_ptr<const void>&>()));
+    using value_type = typename cursor_type::value_type;
+
+    explicit Query(const Enumerator& enumerator)
+      : _cursor(make_cursor(std::make_shared<const Enumerator>(enumerator)))
+    {
+    }
+
+    Enumerable<cursor_type> cursor() const
+    {
+      return Enumerable<cursor_type>(_cursor);
+    }
+
+    std::vector<value_type> to_vector() const
+    {
+      return cursor().to_vector();
+    }
+  private:
+    static cursor_type make_cursor(const std::shared_ptr<const Enumerator>& plan)
+    {
+      return plan->borrow(plan);
+    }
+
+    // Never enumerated itself; every cursor starts as a copy of it.
+    cursor_type _cursor;
+  };
+
   template <typename Enumerator>
   Enumerable<Enumerator> _enumerable(Enumerator enumerator)
   {
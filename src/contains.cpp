@@ -0,0 +1,38 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("contains", [] {
+      it("should find a value that is present", []()
+      {
+        AssertThat(range(0, 10).contains(7), IsTrue());
+      });
+      it("should not find a value that is missing", []()
+      {
+        AssertThat(range(0, 10).contains(10), IsFalse());
+        AssertThat(enumerable(std::vector<int>{}).contains(0), IsFalse());
+      });
+      it("should stop at the first match", []()
+      {
+        size_t calls = 0;
+        auto result = range(0, 1000).select([&](int value)
+        {
+          ++calls;
+          return value;
+        });
+        AssertThat(result.contains(3), IsTrue());
+        AssertThat(calls, Equals(4));
+      });
+    });
+  });
+});
@@ -0,0 +1,84 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("element_at", [] {
+      it("should return the value at the index", []()
+      {
+        AssertThat(range(0, 10).element_at(4), Equals(4));
+        AssertThat(range(0, 10).where([](int) {return true;}).element_at(4), Equals(4));
+      });
+      it("should throw when index is out of range", []()
+      {
+        AssertThrows(invalid_operation, range(0, 10).element_at(10));
+        AssertThrows(invalid_operation, range(0, 10).where([](int) {return true;}).element_at(10));
+      });
+      it("should only invoke selector for the requested value", []()
+      {
+        size_t calls = 0;
+        auto result = range(0, 10).concat(range(10, 20)).select([&](int value)
+        {
+          ++calls;
+          return value * 2;
+        });
+        AssertThat(result.element_at(15), Equals(30));
+        AssertThat(calls, Equals(1));
+      });
+    });
+    describe("last", [] {
+      it("should return the last value", []()
+      {
+        AssertThat(range(0, 10).last(), Equals(9));
+        AssertThat(range(0, 10).where([](int value) {return value < 5;}).last(), Equals(4));
+      });
+      it("should throw for an empty input", []()
+      {
+        AssertThrows(invalid_operation, enumerable(std::vector<int>{}).last());
+        AssertThrows(invalid_operation, range(0, 10).where([](int) {return false;}).last());
+      });
+      it("should return the largest key after order_by", []()
+      {
+        auto input = enumerable(std::vector<int>{5, 3, 8, 13, 1, 11});
+        AssertThat(input.order_by([](int value) {return value;}).last(), Equals(13));
+        AssertThat(input.order_by([](int value) {return value % 2;}).last(), Equals(11));
+      });
+      it("should leave an order_by ready to enumerate from the start", []()
+      {
+        auto sorted = enumerable(std::vector<int>{5, 3, 8, 13, 1, 11}).order_by([](int value) {return value;});
+        AssertThat(sorted.last(), Equals(13));
+        AssertThat(sorted.move_next(), IsTrue());
+        AssertThat(sorted.current(), Equals(1));
+      });
+    });
+    describe("last_or_default", [] {
+      it("should return the last value", []()
+      {
+        AssertThat(range(0, 10).last_or_default(), Equals(9));
+        AssertThat(range(0, 10).last_or_default([](int value) {return value < 5;}), Equals(4));
+      });
+      it("should return default for an empty input", []()
+      {
+        AssertThat(enumerable(std::vector<int>{}).last_or_default(), Equals(int{}));
+        AssertThat(range(1, 10).last_or_default([](int) {return false;}), Equals(int{}));
+      });
+    });
+    describe("count", [] {
+      it("should return the number of values", []()
+      {
+        AssertThat(range(0, 10).count(), Equals(10));
+        AssertThat(range(0, 10).skip(3).count(), Equals(7));
+        AssertThat(range(0, 10).where([](int value) {return value % 2 == 0;}).count(), Equals(5));
+      });
+    });
+  });
+});
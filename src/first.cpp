@@ -0,0 +1,70 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("first", [] {
+      it("should return the first value", []()
+      {
+        AssertThat(range(3, 10).first(), Equals(3));
+        AssertThat(range(3, 10).first([](int value) {return value > 5;}), Equals(6));
+      });
+      it("should throw for an empty input", []()
+      {
+        AssertThrows(invalid_operation, enumerable(std::vector<int>{}).first());
+        AssertThrows(invalid_operation, range(0, 10).first([](int value) {return value > 20;}));
+      });
+      it("should stop at the first match", []()
+      {
+        size_t calls = 0;
+        auto result = range(0, 1000).select([&](int value)
+        {
+          ++calls;
+          return value;
+        }).first([](int value) {return value == 10;});
+        AssertThat(result, Equals(10));
+        AssertThat(calls, Equals(11));
+      });
+      it("should return the smallest key after order_by", []()
+      {
+        auto input = enumerable(std::vector<int>{5, 3, 8, 13, 1, 11});
+        AssertThat(input.order_by([](int value) {return value;}).first(), Equals(1));
+        AssertThat(input.order_by([](int value) {return value;}, std::greater<int>{}).first(), Equals(13));
+        AssertThat(input.order_by([](int value) {return value % 2;}).first(), Equals(8));
+      });
+      it("should leave an order_by ready to enumerate from the start", []()
+      {
+        auto sorted = enumerable(std::vector<int>{5, 3, 8, 13, 1, 11}).order_by([](int value) {return value;});
+        AssertThat(sorted.first(), Equals(1));
+        size_t count = 0;
+        while (sorted.move_next())
+        {
+          ++count;
+        }
+        AssertThat(count, Equals(6));
+      });
+    });
+    describe("first_or_default", [] {
+      it("should return the first value", []()
+      {
+        AssertThat(range(3, 10).first_or_default(), Equals(3));
+        AssertThat(range(3, 10).first_or_default([](int value) {return value > 5;}), Equals(6));
+      });
+      it("should return default for an empty input", []()
+      {
+        AssertThat(enumerable(std::vector<int>{}).first_or_default(), Equals(int{}));
+        AssertThat(range(1, 10).first_or_default([](int value) {return value > 20;}), Equals(int{}));
+        AssertThat(enumerable(std::vector<int>{}).order_by([](int value) {return value;}).first_or_default(), Equals(int{}));
+      });
+    });
+  });
+});
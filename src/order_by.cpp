@@ -0,0 +1,288 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+#include <string>
+#include <cstdlib>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace linq;
+using namespace bandit;
+
+namespace
+{
+  struct record
+  {
+    int id;
+    std::string name;
+  };
+
+  struct person
+  {
+    int age;
+    std::string name;
+  };
+
+  // Reads back more than it writes, so every spilled record looks cut short.
+  struct truncated
+  {
+    int value;
+  };
+
+  std::string make_temp_directory()
+  {
+#ifdef _WIN32
+    const char* root = std::getenv("TEMP");
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+      auto path = std::string(root ? root : ".") + "\\linqpp-" + std::to_string(std::rand());
+      if (_mkdir(path.c_str()) == 0)
+        return path;
+    }
+    return std::string{};
+#else
+    const char* root = std::getenv("TMPDIR");
+    auto path = std::string(root ? root : "/tmp") + "/linqpp-XXXXXX";
+    return mkdtemp(&path[0]) ? path : std::string{};
+#endif
+  }
+
+  // Fails while the directory still holds files, which is how the tests
+  // check that spilled runs were cleaned up.
+  bool remove_directory(const std::string& path)
+  {
+#ifdef _WIN32
+    return _rmdir(path.c_str()) == 0;
+#else
+    return rmdir(path.c_str()) == 0;
+#endif
+  }
+}
+
+namespace linq
+{
+  template <>
+  struct serializer<record>
+  {
+    static bool write(std::FILE* file, const record& value)
+    {
+      return serializer<int>::write(file, value.id)
+        && serializer<std::string>::write(file, value.name);
+    }
+
+    static bool read(std::FILE* file, record& value)
+    {
+      return serializer<int>::read(file, value.id)
+        && serializer<std::string>::read(file, value.name);
+    }
+  };
+
+  template <>
+  struct serializer<truncated>
+  {
+    static bool write(std::FILE* file, const truncated& value)
+    {
+      return serializer<int>::write(file, value.value);
+    }
+
+    static bool read(std::FILE* file, truncated& value)
+    {
+      int padding;
+      return serializer<int>::read(file, value.value)
+        && serializer<int>::read(file, padding);
+    }
+  };
+}
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("order_by", [] {
+      const size_t budgets[] = {
+        0,
+        1,
+        1024
+      };
+      it("should use deferred execution", []()
+      {
+        bool funcCalled = false;
+        auto result = range(0, 10).order_by([&](int value)
+        {
+          funcCalled = true;
+          return value;
+        });
+        AssertThat(funcCalled, IsFalse());
+      });
+      it("should return values in key order", [&]()
+      {
+        for (auto budget : budgets)
+        {
+          auto directory = make_temp_directory();
+          auto result = range(0, 5000)
+            .select([](int value) {return (value * 7919) % 5000;})
+            .order_by([](int value) {return value;})
+            .memory_budget(budget, directory)
+            .to_vector();
+          AssertThat(result.size(), Equals(5000));
+          for (size_t i = 0; i < result.size(); ++i)
+          {
+            AssertThat(result[i], Equals(static_cast<int>(i)));
+          }
+          AssertThat(remove_directory(directory), IsTrue());
+        }
+      });
+      it("should keep values with equal keys in input order", [&]()
+      {
+        for (auto budget : budgets)
+        {
+          auto directory = make_temp_directory();
+          auto result = range(0, 1000)
+            .order_by([](int value) {return value % 3;})
+            .memory_budget(budget, directory)
+            .to_vector();
+          AssertThat(result.size(), Equals(1000));
+          for (size_t i = 1; i < result.size(); ++i)
+          {
+            if (result[i - 1] % 3 == result[i] % 3)
+              AssertThat(result[i - 1] < result[i], IsTrue());
+            else
+              AssertThat(result[i - 1] % 3 < result[i] % 3, IsTrue());
+          }
+          AssertThat(remove_directory(directory), IsTrue());
+        }
+      });
+      it("should use the comparer", [&]()
+      {
+        for (auto budget : budgets)
+        {
+          auto directory = make_temp_directory();
+          auto result = range(0, 100)
+            .order_by([](int value) {return value;}, std::greater<int>{})
+            .memory_budget(budget, directory)
+            .to_vector();
+          AssertThat(result.size(), Equals(100));
+          AssertThat(result[0], Equals(99));
+          AssertThat(result[99], Equals(0));
+          AssertThat(remove_directory(directory), IsTrue());
+        }
+      });
+      it("should spill values that need a serializer", [&]()
+      {
+        for (auto budget : budgets)
+        {
+          auto directory = make_temp_directory();
+          auto result = range(0, 300)
+            .select([](int value) {return record{value, std::to_string(value % 100)};})
+            .order_by([](const record& value) {return value.name;})
+            .memory_budget(budget, directory)
+            .to_vector();
+          AssertThat(result.size(), Equals(300));
+          AssertThat(result[0].name, Equals(std::string("0")));
+          AssertThat(result[0].id, Equals(0));
+          AssertThat(result[1].id, Equals(100));
+          AssertThat(result[2].id, Equals(200));
+          AssertThat(result[299].name, Equals(std::string("99")));
+          AssertThat(remove_directory(directory), IsTrue());
+        }
+      });
+      it("should keep values with equal keys in input order across merge levels", []()
+      {
+        // One run per element: 63 full merges on the first level plus 63
+        // loose runs, more than a single merge may take.
+        auto directory = make_temp_directory();
+        auto result = range(0, 63 * 64 + 63)
+          .order_by([](int value) {return value % 3;})
+          .memory_budget(1, directory)
+          .to_vector();
+        AssertThat(result.size(), Equals(63 * 64 + 63));
+        for (size_t i = 1; i < result.size(); ++i)
+        {
+          if (result[i - 1] % 3 == result[i] % 3)
+            AssertThat(result[i - 1] < result[i], IsTrue());
+          else
+            AssertThat(result[i - 1] % 3 < result[i] % 3, IsTrue());
+        }
+        AssertThat(remove_directory(directory), IsTrue());
+      });
+      it("should throw rather than drop a record it cannot read back", []()
+      {
+        auto directory = make_temp_directory();
+        {
+          auto result = range(0, 10)
+            .select([](int value) {return truncated{value};})
+            .order_by([](const truncated& value) {return value.value;})
+            .memory_budget(1, directory);
+          AssertThrows(std::runtime_error, result.to_vector());
+        }
+        AssertThat(remove_directory(directory), IsTrue());
+      });
+      it("should return expected values when enumerated twice", [&]()
+      {
+        for (auto budget : budgets)
+        {
+          auto directory = make_temp_directory();
+          auto result = range(0, 100)
+            .order_by([](int value) {return -value;})
+            .memory_budget(budget, directory);
+          AssertThat(result.to_vector().size(), Equals(100));
+          auto second = result.to_vector();
+          AssertThat(second.size(), Equals(100));
+          AssertThat(second[0], Equals(99));
+          result.reset();
+          AssertThat(remove_directory(directory), IsTrue());
+        }
+      });
+      it("should spill into the given directory and remove the runs afterwards", []()
+      {
+        auto directory = make_temp_directory();
+        AssertThat(directory.empty(), IsFalse());
+        auto result = range(0, 2000)
+          .select([](int value) {return std::to_string((value * 7919) % 2000);})
+          .order_by([](const std::string& value) {return std::stoi(value);})
+          .memory_budget(1024, directory);
+        AssertThat(result.move_next(), IsTrue());
+        AssertThat(result.current(), Equals(std::string("0")));
+        AssertThat(remove_directory(directory), IsFalse());
+        size_t count = 1;
+        while (result.move_next())
+        {
+          AssertThat(result.current(), Equals(std::to_string(count)));
+          ++count;
+        }
+        AssertThat(count, Equals(2000));
+        result.reset();
+        AssertThat(remove_directory(directory), IsTrue());
+      });
+      it("should sort values that have no serializer when no budget is set", []()
+      {
+        auto result = enumerable(std::vector<person>{{40, "c"}, {20, "a"}, {30, "b"}})
+          .order_by([](const person& value) {return value.age;})
+          .to_vector();
+        AssertThat(result.size(), Equals(3));
+        AssertThat(result[0].name, Equals(std::string("a")));
+        AssertThat(result[1].name, Equals(std::string("b")));
+        AssertThat(result[2].name, Equals(std::string("c")));
+      });
+      it("should return no items for an empty input", [&]()
+      {
+        for (auto budget : budgets)
+        {
+          auto directory = make_temp_directory();
+          auto result = enumerable(std::vector<int>{})
+            .order_by([](int value) {return value;})
+            .memory_budget(budget, directory);
+          AssertThat(result.move_next(), IsFalse());
+          result.reset();
+          AssertThat(remove_directory(directory), IsTrue());
+        }
+      });
+    });
+  });
+});
@@ -0,0 +1,50 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("pairwise", [] {
+      it("should return consecutive pairs", []()
+      {
+        auto result = range(0, 5).pairwise().to_vector();
+        AssertThat(result.size(), Equals(4));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i].first, Equals(static_cast<int>(i)));
+          AssertThat(result[i].second, Equals(static_cast<int>(i + 1)));
+        }
+      });
+      it("should return no items for fewer than two values", []()
+      {
+        AssertThat(enumerable(std::vector<int>{}).pairwise().to_vector().size(), Equals(0));
+        AssertThat(enumerable(std::vector<int>{1}).pairwise().to_vector().size(), Equals(0));
+      });
+      it("should compute deltas", []()
+      {
+        auto result = enumerable(std::vector<int>{1, 4, 9, 16})
+          .pairwise()
+          .select([](std::pair<int, int> pair) {return pair.second - pair.first;})
+          .to_vector();
+        AssertThat(result.size(), Equals(3));
+        AssertThat(result[0], Equals(3));
+        AssertThat(result[1], Equals(5));
+        AssertThat(result[2], Equals(7));
+      });
+      it("should return expected values when enumerated twice", []()
+      {
+        auto result = range(0, 5).pairwise();
+        AssertThat(result.to_vector().size(), Equals(4));
+        AssertThat(result.to_vector().size(), Equals(4));
+      });
+    });
+  });
+});
@@ -0,0 +1,148 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("pipelined", [] {
+      const size_t sizes[] = {
+        0,
+        1,
+        63,
+        64,
+        65,
+        235725
+      };
+      it("should use deferred execution", []()
+      {
+        bool funcCalled = false;
+        auto source = std::vector<std::function<int()>>{
+          [&]() {funcCalled = true; return 1;}
+        };
+        auto result = enumerable(source).select([](std::function<int()> fn)
+        {
+          return fn();
+        }).pipelined();
+        AssertThat(funcCalled, IsFalse());
+      });
+      it("should return expected values in order", [&]()
+      {
+        for (auto size : sizes)
+        {
+          auto result = range(static_cast<size_t>(0), size)
+            .select([](size_t value)
+          {
+            return value + 1;
+          })
+            .async_stage(2, 16)
+            .to_vector();
+          AssertThat(result.size(), Equals(size));
+          for (size_t i = 0; i < result.size(); ++i)
+          {
+            AssertThat(result[i], Equals(i + 1));
+          }
+        }
+      });
+      it("should return expected values across several stages", []()
+      {
+        auto result = range(0, 10000)
+          .select([](int value) {return value * 2;})
+          .pipelined()
+          .select([](int value) {return value + 1;})
+          .async_stage(1, 1)
+          .where([](int value) {return value % 3 == 0;})
+          .to_vector();
+        AssertThat(result.size(), Equals(3333));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(i * 6 + 3)));
+        }
+      });
+      it("should return expected values when enumerated twice", []()
+      {
+        auto result = range(0, 1000).pipelined();
+        auto first = result.to_vector();
+        auto second = result.to_vector();
+        AssertThat(first.size(), Equals(1000));
+        AssertThat(second.size(), Equals(1000));
+        for (size_t i = 0; i < second.size(); ++i)
+        {
+          AssertThat(second[i], Equals(static_cast<int>(i)));
+        }
+      });
+      it("should stop the producer when abandoned before the end", []()
+      {
+        auto result = range(0, 100000).async_stage(1, 1);
+        AssertThat(result.move_next(), IsTrue());
+        AssertThat(result.current(), Equals(0));
+        result.reset();
+        AssertThat(result.move_next(), IsTrue());
+        AssertThat(result.current(), Equals(0));
+      });
+      it("should throw after enumerating", []()
+      {
+        auto value = range(0, 10).pipelined();
+        while(value.move_next()){}
+        AssertThrows(invalid_operation, value.current());
+      });
+      it("should propagate exception thrown upstream to caller of move_next()", []()
+      {
+        auto input = range(0, 10);
+        auto result = input.select([](int value)
+        {
+          if (value == 5)
+            throw invalid_operation();
+          return value;
+        }).async_stage(4, 2);
+        for (int i = 0; i < 5; ++i)
+        {
+          AssertThat(result.move_next(), IsTrue());
+          AssertThat(result.current(), Equals(i));
+        }
+        AssertThrows(invalid_operation, result.move_next());
+      });
+      it("should not repeat a batch after an exception thrown upstream", []()
+      {
+        auto result = range(0, 10).select([](int value)
+        {
+          if (value == 4)
+            throw invalid_operation();
+          return value;
+        }).async_stage(4, 2);
+        for (int i = 0; i < 4; ++i)
+        {
+          AssertThat(result.move_next(), IsTrue());
+          AssertThat(result.current(), Equals(i));
+        }
+        AssertThrows(invalid_operation, result.move_next());
+        AssertThat(result.move_next(), IsFalse());
+        AssertThrows(invalid_operation, result.current());
+      });
+      it("should stop the producer once a terminal has its answer", []()
+      {
+        std::atomic<size_t> calls{0};
+        auto result = range(0, 1000000).select([&](int value)
+        {
+          ++calls;
+          return value;
+        }).async_stage(2, 16);
+        AssertThat(result.first(), Equals(0));
+        auto callsAfterFirst = calls.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        AssertThat(calls.load(), Equals(callsAfterFirst));
+        AssertThat(callsAfterFirst < 1000, IsTrue());
+      });
+    });
+  });
+});
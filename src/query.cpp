@@ -0,0 +1,171 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+#include <thread>
+#include <atomic>
+
+using namespace linq;
+using namespace bandit;
+
+namespace
+{
+  struct counted_collection
+  {
+    using const_iterator = std::vector<int>::const_iterator;
+
+    static int copies;
+
+    explicit counted_collection(std::vector<int> values)
+      : values(std::move(values))
+    {
+    }
+
+    counted_collection(const counted_collection& other)
+      : values(other.values)
+    {
+      ++copies;
+    }
+
+    std::vector<int> values;
+  };
+
+  int counted_collection::copies = 0;
+
+  counted_collection::const_iterator begin(const counted_collection& collection)
+  {
+    return collection.values.begin();
+  }
+
+  counted_collection::const_iterator end(const counted_collection& collection)
+  {
+    return collection.values.end();
+  }
+
+  struct counted_selector
+  {
+    static int copies;
+
+    counted_selector()
+    {
+    }
+
+    counted_selector(const counted_selector&)
+    {
+      ++copies;
+    }
+
+    int operator()(int value) const
+    {
+      return value * 2;
+    }
+  };
+
+  int counted_selector::copies = 0;
+}
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("plan", [] {
+      it("should return the same values as the pipeline", []()
+      {
+        auto query = range(0, 100)
+          .where([](int value) {return value % 2 == 0;})
+          .select([](int value) {return value + 1;});
+        auto plan = query.plan();
+        auto expected = query.to_vector();
+        auto result = plan.cursor().to_vector();
+        AssertThat(result.size(), Equals(expected.size()));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(expected[i]));
+        }
+        AssertThat(plan.to_vector().size(), Equals(expected.size()));
+      });
+      it("should give each cursor its own position", []()
+      {
+        auto plan = range(0, 10).select([](int value) {return value;}).plan();
+        auto first = plan.cursor();
+        auto second = plan.cursor();
+        AssertThat(first.move_next(), IsTrue());
+        AssertThat(first.move_next(), IsTrue());
+        AssertThat(second.move_next(), IsTrue());
+        AssertThat(first.current(), Equals(1));
+        AssertThat(second.current(), Equals(0));
+      });
+      it("should start cursors from the beginning of a partly enumerated pipeline", []()
+      {
+        auto query = range(0, 5).select([](int value) {return value;});
+        for (int i = 0; i < 3; ++i)
+        {
+          AssertThat(query.move_next(), IsTrue());
+        }
+        auto cursor = query.plan().cursor();
+        for (int i = 0; i < 5; ++i)
+        {
+          AssertThat(cursor.move_next(), IsTrue());
+          AssertThat(cursor.current(), Equals(i));
+        }
+        AssertThat(cursor.move_next(), IsFalse());
+      });
+      it("should not copy the source or selectors when opening cursors", []()
+      {
+        auto plan = enumerable(counted_collection{std::vector<int>{1, 2, 3}})
+          .select(counted_selector{})
+          .plan();
+        counted_collection::copies = 0;
+        counted_selector::copies = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+          auto result = plan.cursor().to_vector();
+          AssertThat(result.size(), Equals(3));
+          AssertThat(result[2], Equals(6));
+        }
+        AssertThat(counted_collection::copies, Equals(0));
+        AssertThat(counted_selector::copies, Equals(0));
+      });
+      it("should support many threads enumerating one plan at once", []()
+      {
+        const int size = 10000;
+        auto plan = range(0, size)
+          .where([](int value) {return value % 3 != 0;})
+          .select([](int value) {return static_cast<long long>(value) * 2;})
+          .skip(10)
+          .plan();
+        auto expected = plan.to_vector();
+        long long expectedSum = 0;
+        for (auto value : expected)
+          expectedSum += value;
+
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> threads{};
+        for (int t = 0; t < 8; ++t)
+        {
+          threads.emplace_back([&]()
+          {
+            for (int i = 0; i < 50; ++i)
+            {
+              auto cursor = plan.cursor();
+              long long sum = 0;
+              size_t count = 0;
+              while (cursor.move_next())
+              {
+                sum += cursor.current();
+                ++count;
+              }
+              if (sum != expectedSum || count != expected.size())
+                ++mismatches;
+            }
+          });
+        }
+        for (auto& thread : threads)
+          thread.join();
+        AssertThat(mismatches.load(), Equals(0));
+      });
+    });
+  });
+});
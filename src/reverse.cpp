@@ -0,0 +1,57 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("reverse", [] {
+      it("should return values in reverse order", []()
+      {
+        auto result = range(0, 10).reverse().to_vector();
+        AssertThat(result.size(), Equals(10));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(9 - i)));
+        }
+      });
+      it("should return values in reverse order for a source without random access", []()
+      {
+        auto result = range(0, 10).where([](int value) {return value % 2 == 0;}).reverse().to_vector();
+        AssertThat(result.size(), Equals(5));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(8 - i * 2)));
+        }
+      });
+      it("should return no items for an empty input", []()
+      {
+        auto result = enumerable(std::vector<int>{}).reverse().to_vector();
+        AssertThat(result.size(), Equals(0));
+      });
+      it("should only invoke selector for values taken", []()
+      {
+        size_t calls = 0;
+        auto result = range(0, 1000).select([&](int value)
+        {
+          ++calls;
+          return value;
+        })
+          .reverse()
+          .take(3)
+          .to_vector();
+        AssertThat(result.size(), Equals(3));
+        AssertThat(result[0], Equals(999));
+        AssertThat(result[2], Equals(997));
+        AssertThat(calls, Equals(3));
+      });
+    });
+  });
+});
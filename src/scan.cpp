@@ -0,0 +1,51 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("scan", [] {
+      it("should use deferred execution", []()
+      {
+        bool funcCalled = false;
+        auto result = range(0, 10).scan(0, [&](int acc, int value)
+        {
+          funcCalled = true;
+          return acc + value;
+        });
+        AssertThat(funcCalled, IsFalse());
+      });
+      it("should return running totals", []()
+      {
+        auto result = range(1, 6).scan(0, [](int acc, int value) {return acc + value;}).to_vector();
+        AssertThat(result.size(), Equals(5));
+        AssertThat(result[0], Equals(1));
+        AssertThat(result[1], Equals(3));
+        AssertThat(result[4], Equals(15));
+      });
+      it("should restart from the seed when enumerated twice", []()
+      {
+        auto result = range(1, 6).scan(10, [](int acc, int value) {return acc + value;});
+        AssertThat(result.to_vector()[4], Equals(25));
+        AssertThat(result.to_vector()[4], Equals(25));
+      });
+      it("should allow an accumulator of a different type", []()
+      {
+        auto result = range(0, 3).scan(std::string{}, [](std::string acc, int value)
+        {
+          return acc + std::to_string(value);
+        }).to_vector();
+        AssertThat(result.size(), Equals(3));
+        AssertThat(result[2], Equals(std::string("012")));
+      });
+    });
+  });
+});
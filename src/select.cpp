@@ -90,6 +90,29 @@ go_bandit([]()
         AssertThat(hasItems, IsFalse());
         AssertThat(selectorWasCalled, IsFalse());
       });
+      it("should allow a mutable selector", []()
+      {
+        auto result = range(0, 5).select([n = 0](int value) mutable
+        {
+          return value + n++;
+        })
+          .to_vector();
+        AssertThat(result.size(), Equals(5));
+        AssertThat(result[4], Equals(8));
+      });
+      it("should call a mutable selector in order for last, reverse and element_at", []()
+      {
+        auto selector = [n = 0](int value) mutable
+        {
+          return value + n++;
+        };
+        AssertThat(range(0, 5).select(selector).last(), Equals(8));
+        auto reversed = range(0, 5).select(selector).reverse().to_vector();
+        AssertThat(reversed.size(), Equals(5));
+        AssertThat(reversed[0], Equals(8));
+        AssertThat(reversed[4], Equals(0));
+        AssertThat(range(0, 5).select(selector).element_at(2), Equals(4));
+      });
       it("should propagate exception thrown from selector to caller of move_next()", []()
       {
         auto input = range(0, 10);
@@ -0,0 +1,51 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+#include <list>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("select_many", [] {
+      it("should flatten the selected collections", []()
+      {
+        auto result = range(0, 4).select_many([](int value)
+        {
+          return std::vector<int>(static_cast<size_t>(value), value);
+        }).to_vector();
+        AssertThat(result.size(), Equals(6));
+        AssertThat(result[0], Equals(1));
+        AssertThat(result[1], Equals(2));
+        AssertThat(result[3], Equals(3));
+        AssertThat(result[5], Equals(3));
+      });
+      it("should continue from the same place in a copy", []()
+      {
+        auto result = range(0, 2).select_many([](int value)
+        {
+          return std::list<int>{value * 10, value * 10 + 1, value * 10 + 2};
+        });
+        AssertThat(result.move_next(), IsTrue());
+        AssertThat(result.move_next(), IsTrue());
+        auto copy = result;
+        AssertThat(copy.current(), Equals(1));
+        auto rest = std::vector<int>{};
+        while (copy.move_next())
+        {
+          rest.push_back(copy.current());
+        }
+        AssertThat(rest.size(), Equals(4));
+        AssertThat(rest[0], Equals(2));
+        AssertThat(rest[3], Equals(12));
+        AssertThat(result.current(), Equals(1));
+      });
+    });
+  });
+});
@@ -0,0 +1,58 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("single", [] {
+      it("should return the only value", []()
+      {
+        AssertThat(range(7, 8).single(), Equals(7));
+        AssertThat(range(0, 10).single([](int value) {return value == 4;}), Equals(4));
+      });
+      it("should throw for an empty input", []()
+      {
+        AssertThrows(invalid_operation, enumerable(std::vector<int>{}).single());
+      });
+      it("should throw for more than one value", []()
+      {
+        AssertThrows(invalid_operation, range(0, 2).single());
+        AssertThrows(invalid_operation, range(0, 10).single([](int value) {return value > 5;}));
+      });
+      it("should stop after the second value", []()
+      {
+        size_t calls = 0;
+        auto result = range(0, 1000).select([&](int value)
+        {
+          ++calls;
+          return value;
+        });
+        AssertThrows(invalid_operation, result.single());
+        AssertThat(calls, Equals(2));
+      });
+    });
+    describe("single_or_default", [] {
+      it("should return the only value", []()
+      {
+        AssertThat(range(7, 8).single_or_default(), Equals(7));
+      });
+      it("should return default for an empty input", []()
+      {
+        AssertThat(enumerable(std::vector<int>{}).single_or_default(), Equals(int{}));
+        AssertThat(range(1, 10).single_or_default([](int value) {return value > 20;}), Equals(int{}));
+      });
+      it("should throw for more than one value", []()
+      {
+        AssertThrows(invalid_operation, range(0, 2).single_or_default());
+      });
+    });
+  });
+});
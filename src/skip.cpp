@@ -0,0 +1,73 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+#include <list>
+#include <cstdint>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("skip", [] {
+      it("should return remaining values", []()
+      {
+        auto result = range(0, 10).skip(3).to_vector();
+        AssertThat(result.size(), Equals(7));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(i + 3)));
+        }
+      });
+      it("should return no values when skipping past the end", []()
+      {
+        auto result = range(0, 10).skip(20).to_vector();
+        AssertThat(result.size(), Equals(0));
+      });
+      it("should not wrap around when chained skips overflow", []()
+      {
+        auto result = range(0, 10).skip(5).skip(SIZE_MAX);
+        AssertThat(result.to_vector().size(), Equals(0));
+        AssertThat(result.count(), Equals(0));
+      });
+      it("should return remaining values for a source without random access", []()
+      {
+        auto result = enumerable(std::list<int>{0, 1, 2, 3, 4}).skip(2).to_vector();
+        AssertThat(result.size(), Equals(3));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(i + 2)));
+        }
+      });
+      it("should not invoke selector for skipped values", []()
+      {
+        size_t calls = 0;
+        auto result = range(0, 1000000).select([&](int value)
+        {
+          ++calls;
+          return value * 2;
+        })
+          .skip(900000)
+          .take(50)
+          .to_vector();
+        AssertThat(result.size(), Equals(50));
+        AssertThat(result[0], Equals(1800000));
+        AssertThat(calls, Equals(50));
+      });
+      it("should jump into the second half of concat", []()
+      {
+        auto result = range(0, 5).concat(range(10, 15)).skip(7).to_vector();
+        AssertThat(result.size(), Equals(3));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(i + 12)));
+        }
+      });
+    });
+  });
+});
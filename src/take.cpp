@@ -0,0 +1,50 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("take", [] {
+      it("should return the first values", []()
+      {
+        auto result = range(0, 10).take(3).to_vector();
+        AssertThat(result.size(), Equals(3));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(i)));
+        }
+      });
+      it("should return all values when taking more than available", []()
+      {
+        auto result = range(0, 10).take(20).to_vector();
+        AssertThat(result.size(), Equals(10));
+      });
+      it("should be enumerable without reset", []()
+      {
+        auto result = range(0, 10).take(2);
+        AssertThat(result.move_next(), IsTrue());
+        AssertThat(result.move_next(), IsTrue());
+        AssertThat(result.move_next(), IsFalse());
+      });
+      it("should report count without enumerating", []()
+      {
+        size_t calls = 0;
+        auto result = range(0, 10).select([&](int value)
+        {
+          ++calls;
+          return value;
+        }).take(4);
+        AssertThat(result.count(), Equals(4));
+        AssertThat(calls, Equals(0));
+      });
+    });
+  });
+});
@@ -0,0 +1,67 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("window", [] {
+      it("should return every sliding window in order", []()
+      {
+        auto result = range(0, 10).window(3);
+        size_t windows = 0;
+        while (result.move_next())
+        {
+          auto window = result.current();
+          AssertThat(window.size(), Equals(3));
+          for (size_t i = 0; i < window.size(); ++i)
+          {
+            AssertThat(window[i], Equals(static_cast<int>(windows + i)));
+          }
+          ++windows;
+        }
+        AssertThat(windows, Equals(8));
+      });
+      it("should return no items when input is shorter than the window", []()
+      {
+        AssertThat(range(0, 2).window(3).count(), Equals(0));
+        AssertThat(range(0, 2).window(0).count(), Equals(0));
+      });
+      it("should compute a moving average", []()
+      {
+        auto result = range(0, 100000)
+          .where([](int) {return true;})
+          .window(4)
+          .select([](detail::WindowView<int> window)
+        {
+          int sum = 0;
+          for (auto value : window)
+            sum += value;
+          return sum / 4.0;
+        })
+          .to_vector();
+        AssertThat(result.size(), Equals(99997));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(i + 1.5));
+        }
+      });
+      it("should return expected values when enumerated twice", []()
+      {
+        auto result = range(0, 5).window(2).select([](detail::WindowView<int> window) {return window[0];});
+        AssertThat(result.to_vector().size(), Equals(4));
+        auto second = result.to_vector();
+        AssertThat(second.size(), Equals(4));
+        AssertThat(second[0], Equals(0));
+        AssertThat(second[3], Equals(3));
+      });
+    });
+  });
+});
@@ -0,0 +1,62 @@
+// Copyright (c) Alex Perovich. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "pch.h"
+#include "enumerable.hpp"
+#include <bandit/bandit.h>
+
+using namespace linq;
+using namespace bandit;
+
+go_bandit([]()
+{
+  describe("enumerable", []()
+  {
+    describe("zip", [] {
+      it("should combine values with the result selector", []()
+      {
+        auto result = range(0, 10).zip(range(100, 110), [](int first, int second)
+        {
+          return first + second;
+        }).to_vector();
+        AssertThat(result.size(), Equals(10));
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+          AssertThat(result[i], Equals(static_cast<int>(100 + i * 2)));
+        }
+      });
+      it("should return pairs without a result selector", []()
+      {
+        auto result = range(0, 3).zip(range(3, 6)).to_vector();
+        AssertThat(result.size(), Equals(3));
+        AssertThat(result[1].first, Equals(1));
+        AssertThat(result[1].second, Equals(4));
+      });
+      it("should stop at the end of the shorter input", []()
+      {
+        AssertThat(range(0, 10).zip(range(0, 4)).to_vector().size(), Equals(4));
+        AssertThat(range(0, 4).zip(range(0, 10)).to_vector().size(), Equals(4));
+        AssertThat(range(0, 10).zip(range(0, 4)).count(), Equals(4));
+      });
+      it("should call a mutable result selector in order for last", []()
+      {
+        auto result = range(0, 5).zip(range(0, 5), [n = 0](int first, int second) mutable
+        {
+          return first + second + n++;
+        });
+        AssertThat(result.last(), Equals(12));
+      });
+      it("should work over streaming inputs", []()
+      {
+        auto evens = range(0, 100).where([](int value) {return value % 2 == 0;});
+        auto odds = range(0, 100).where([](int value) {return value % 2 == 1;});
+        auto result = evens.zip(odds, [](int first, int second) {return second - first;}).to_vector();
+        AssertThat(result.size(), Equals(50));
+        for (auto value : result)
+        {
+          AssertThat(value, Equals(1));
+        }
+      });
+    });
+  });
+});